@@ -0,0 +1,102 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: kernelconfig.h
+ * Description: Compile-time sizes of the kernel tables. The default profile
+ *              uses the limits from phase1.h and phase2.h. Pick another one
+ *              with -DKERNEL_PROFILE=..., or set any single limit with
+ *              -DKERNEL_MAXPROC=... and the like. Every table and every scan
+ *              over one is sized by these constants, so the compiler sees the
+ *              real bounds.
+ */
+
+#ifndef KERNELCONFIG_H
+#define KERNELCONFIG_H
+
+// kernel profiles
+#define KERNEL_PROFILE_COURSE 0 // the limits from the course headers
+#define KERNEL_PROFILE_SMALL 1 // few processes and mailboxes, for small memory targets
+#define KERNEL_PROFILE_LARGE 2 // many processes and mailboxes, for heavy load
+
+#ifndef KERNEL_PROFILE
+#define KERNEL_PROFILE KERNEL_PROFILE_COURSE
+#endif
+
+// power of two process table sizes let pid % KERNEL_MAXPROC compile to a mask
+#if KERNEL_PROFILE == KERNEL_PROFILE_SMALL
+#ifndef KERNEL_MAXPROC
+#define KERNEL_MAXPROC 16
+#endif
+#ifndef KERNEL_MAXMBOX
+#define KERNEL_MAXMBOX 64
+#endif
+#ifndef KERNEL_MAXSLOTS
+#define KERNEL_MAXSLOTS 128
+#endif
+// most slots go to small messages, so only KERNEL_MAXSLOTS / 4 messages
+// larger than 8 bytes, and KERNEL_MAXSLOTS / 8 larger than 64 bytes, fit at once
+#ifndef KERNEL_SLOTS_0
+#define KERNEL_SLOTS_0 KERNEL_MAXSLOTS
+#endif
+#ifndef KERNEL_SLOTS_8
+#define KERNEL_SLOTS_8 KERNEL_MAXSLOTS
+#endif
+#ifndef KERNEL_SLOTS_64
+#define KERNEL_SLOTS_64 (KERNEL_MAXSLOTS / 8)
+#endif
+#ifndef KERNEL_SLOTS_MAX
+#define KERNEL_SLOTS_MAX (KERNEL_MAXSLOTS / 8)
+#endif
+#elif KERNEL_PROFILE == KERNEL_PROFILE_LARGE
+#ifndef KERNEL_MAXPROC
+#define KERNEL_MAXPROC 256
+#endif
+#ifndef KERNEL_MAXMBOX
+#define KERNEL_MAXMBOX 8192
+#endif
+#ifndef KERNEL_MAXSLOTS
+#define KERNEL_MAXSLOTS 16384
+#endif
+#endif
+
+#ifndef KERNEL_MAXPROC
+#define KERNEL_MAXPROC MAXPROC // process table size
+#endif
+#ifndef KERNEL_MAXMBOX
+#define KERNEL_MAXMBOX MAXMBOX // mailbox table size
+#endif
+#ifndef KERNEL_MAXSLOTS
+#define KERNEL_MAXSLOTS MAXSLOTS // mail slots in use at once over all mailboxes
+#endif
+// slots per message size class, a class that runs out borrows from larger
+// ones. By default every slot is full size, so the split saves no memory.
+// Only the small profile, or a build that lowers KERNEL_SLOTS_MAX, gets a
+// smaller footprint, and then fewer than KERNEL_MAXSLOTS large messages fit
+#ifndef KERNEL_SLOTS_0
+#define KERNEL_SLOTS_0 0 // for empty messages
+#endif
+#ifndef KERNEL_SLOTS_8
+#define KERNEL_SLOTS_8 0 // for messages up to 8 bytes
+#endif
+#ifndef KERNEL_SLOTS_64
+#define KERNEL_SLOTS_64 0 // for messages up to 64 bytes
+#endif
+#ifndef KERNEL_SLOTS_MAX
+#define KERNEL_SLOTS_MAX KERNEL_MAXSLOTS // for messages up to MAX_MESSAGE bytes
+#endif
+#ifndef KERNEL_MBOX_BUFFERS
+#define KERNEL_MBOX_BUFFERS 64 // kernel buffers for zero-copy mailboxes
+#endif
+#ifndef KERNEL_MBOX_BUFFER_SIZE
+#define KERNEL_MBOX_BUFFER_SIZE 512 // bytes in each zero-copy buffer, one disk sector
+#endif
+#ifndef KERNEL_PRIORITIES
+#define KERNEL_PRIORITIES 6 // priority levels, the last one is only for init
+#endif
+
+// the run queues are tracked in the bits of an unsigned int
+#if KERNEL_PRIORITIES < 2 || KERNEL_PRIORITIES > 32
+#error "KERNEL_PRIORITIES must be between 2 and 32"
+#endif
+
+#endif
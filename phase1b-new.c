@@ -8,46 +8,120 @@
 
 #include "phase1helper.h"
 #include "phase1.h"
+#include "phase1ext.h"
 #include "usloss.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <time.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
-#define RUNNABLE 0
-#define RUNNING 1
-#define ZOMBIE 2
-#define BLOCKED_ON_JOIN 3
-#define FREE 4
-#define BLOCKED 5
+#define RUNNABLE PROC_RUNNABLE
+#define RUNNING PROC_RUNNING
+#define ZOMBIE PROC_ZOMBIE
+#define BLOCKED_ON_JOIN PROC_BLOCKED_ON_JOIN
+#define FREE PROC_FREE
+#define BLOCKED PROC_BLOCKED
+#define BLOCKED_ON_ZAP PROC_BLOCKED_ON_ZAP
+
+#define LOWEST_PRIORITY (KERNEL_PRIORITIES - 1) // lowest priority a process other than init can have
+
+#define TIME_SLICE 80000 // default 80ms time slice in microseconds
+
+#ifndef AGING_THRESHOLD
+#define AGING_THRESHOLD 0 // quanta a runnable process waits before it is promoted, 0 disables aging
+#endif
+
+#ifndef SCHED_POLICY
+#define SCHED_POLICY SCHED_FIXED // scheduler used after phase1_init, see phase1ext.h
+#endif
+
+#define MLFQ_BOOST_PERIOD 1000000 // 1s between MLFQ priority boosts, in microseconds
+
+#define STACK_POOL_CLASSES 4 // pooled stacks are 1, 2, 4 or 8 times USLOSS_MIN_STACK
+#define STACK_POOL_PREALLOC 8 // stacks allocated per class at phase1_init
+
+#ifndef STACK_GUARD
+#define STACK_GUARD 0 // 1 to mmap stacks below a guard page and report their high-water marks
+#endif
+#define STACK_CANARY 0xA5 // byte painted over guarded stacks to find how deep they were used
+
+#ifndef PRIORITY_INHERIT
+#define PRIORITY_INHERIT 0 // 1 to let blocked processes lend their priority to the process they wait for
+#endif
+
+#ifndef SCHED_TRACE
+#define SCHED_TRACE 0 // 1 to record scheduler events in the trace ring buffer, see schedtrace.h
+#endif
 
 
 typedef struct Process Process;
+typedef struct ProcessInfo ProcessInfo;
 typedef struct RunQueue RunQueue;
+typedef struct StackPool StackPool;
+typedef struct SchedOps SchedOps;
 
 /**
  * Struct to represent a process.
  * 
- * Includes information about the process such as pid, status, priority, name, start function,
- * argument, stack size, context, stack, parent, child, sibling, child count, and exit state.
+ * Includes the fields the scheduler and the process tree touch, such as pid, status,
+ * priority, run queue links, parent, child, sibling, child count, zombie children
+ * waiting to be joined, zappers waiting for it to quit, exit state, CPU time accounting,
+ * and scheduling statistics.
+ * Fields used only at creation and context switch time live in ProcessInfo, so the
+ * process table stays small and scans over it touch fewer cache lines.
  */
 struct Process{  
     int pid; 
     int status;
     int priority;
-    char name[MAXNAME];
-    int (*startFunc)(char*);
-    char *arg;
-    int stackSize;
-    USLOSS_Context context;
-    void* stack;
+    int effPriority; // priority set by the scheduler policy, see getRunLevel
+    int donations[KERNEL_PRIORITIES]; // processes lending their priority to this one, by priority
+    int lentLevel; // priority this process lends while it is blocked, 0 if none
+    int queuedSince; // time the process was placed in its run queue
+    Process* nextInQueue; // for run queue
+    Process* prevInQueue; // for run queue
     Process* parent;
     Process* child;
     Process* sibling;
+    Process* prevSibling;
     int childCount;
+    Process* zombieHead; // children that quit but were not joined, oldest first
+    Process* zombieTail;
+    Process* nextZombie; // for the parent's zombie list
     int exitState;
-    Process* nextInQueue; // for run queue
     int blockStatus; // for blockMe
+    int pgid; // process group, inherited from the parent unless set by sporkGroup
+    int zapped; // set once another process has zapped this one
+    Process* groupZapper; // process blocked in zapGroup until this one quits
+    int groupPending; // group members this process is waiting for in zapGroup
+    int autoReap; // children that quit are reaped without a join
+    Process* zapperHead; // processes blocked in zap() on this process
+    Process* nextZapper; // for the target's zapper list
+    int quantumStart; // time the process was last switched in
+    int cpuTime; // total time spent running, in microseconds
+    int stateSince; // time the status last changed
+    int waitTime; // total time spent runnable but not running
+    int blockedTime; // total time spent blocked
+    int switches; // times switched in
+    int voluntary; // times switched out after blocking or quitting
+    int involuntary; // times switched out while still runnable
+};
+
+/**
+ * Struct to represent the rarely used part of a process.
+ * 
+ * Includes the name, start function, argument, stack size, context, and stack.
+ * Entry i belongs to processTable[i]. The stack and context are only set up
+ * the first time the process is switched to, so stack is NULL until then.
+ */
+struct ProcessInfo{
+    char name[MAXNAME];
+    int (*startFunc)(char*);
+    char *arg;
+    int stackSize;
+    USLOSS_Context context;
+    void* stack;
 };
 
 /**
@@ -62,103 +136,1031 @@ struct RunQueue{
     Process* tail;
 };
 
-Process processTable[MAXPROC];
+/**
+ * Struct to represent the free stacks of one size class.
+ * 
+ * Free stacks are kept in a LIFO list threaded through the first word of each stack.
+ */
+struct StackPool{
+    int stackSize;
+    void* freeList;
+    int freeCount;
+};
+
+/**
+ * Struct to represent a scheduler policy.
+ * 
+ * The dispatcher calls these hooks to let the policy move processes between
+ * priority levels. Each hook may only change effPriority of a process that is
+ * not in a run queue, or must remove and re-place it around the change.
+ */
+struct SchedOps{
+    void (*tick)(void); // called by the dispatcher before it picks a process
+    void (*expired)(Process* process); // the running process used up its time slice
+    void (*preempted)(Process* process); // a runnable process is switched out, not in a queue
+    void (*blocked)(Process* process, int ran); // a process is switched out after blocking or quitting
+};
+
+Process processTable[KERNEL_MAXPROC];
+ProcessInfo processInfo[KERNEL_MAXPROC];
 Process* currentProcess;
-RunQueue runQueue[6];
-int PID;
+RunQueue runQueue[KERNEL_PRIORITIES];
+unsigned int readyMask; // bit i is set when runQueue[i] is non-empty
+int PID; // lower bound for the next pid handed out
+int freeSlots[KERNEL_MAXPROC]; // FIFO ring of free process table slots
+int freeSlotHead;
+int freeSlotCount;
 int processCount;
-clock_t lastSwitchTime;
+Process* reapHead; // quit children of auto-reaping parents, freed by the dispatcher
+StackPool stackPool[STACK_POOL_CLASSES];
+int stackPoolHits; // stacks handed out from the pool
+int stackPoolMisses; // stacks that had to be malloc'd
+int stacksInUse;
+int stackHighWater; // most stacks in use at once
+int stackGuard;
+int agingThreshold;
+int inheritEnabled;
+int quantumTable[KERNEL_PRIORITIES]; // time slice for each priority, in microseconds
+SchedOps* schedOps;
+int needResched; // set when the dispatcher may need to pick a different process
+int dispatchCount; // dispatcher calls that looked for a process to run
+int dispatchesAvoided; // dispatcher calls skipped because nothing changed
+int traceEnabled;
+TraceRecord traceBuffer[TRACE_SIZE];
+unsigned int traceNext; // total records written, the oldest is overwritten once the buffer is full
+int lastBoost; // time of the last MLFQ priority boost
+
+/**
+ * This helper function prints the run queue.
+ */
+void printRunQueue(){
+    for (int i = 0; i < KERNEL_PRIORITIES; i++) {
+        USLOSS_Console("Priority: %d\n", i + 1);
+        Process* process = runQueue[i].head;
+        while (process != NULL) {
+            USLOSS_Console("Process: %d, next: %d\n", process->pid, process->nextInQueue == NULL ? -1 : process->nextInQueue->pid);
+            process = process->nextInQueue;
+        }
+    }
+}
+
+/**
+ * This helper function returns the rarely used part of a process.
+ * 
+ * @param process - the process
+ * 
+ * @return the process's entry in processInfo
+ */
+ProcessInfo* getInfo(Process* process){
+    return &processInfo[process - processTable];
+}
+
+/**
+ * This function writes the records in the trace ring buffer, oldest first, to
+ * TRACE_FILE. It is registered with atexit for a normal halt, and
+ * haltWithTrace calls it for the error halts, which abort instead of exiting.
+ * Does nothing if no events were recorded.
+ */
+void dumpSchedTrace(void){
+    if (traceNext == 0) {
+        return;
+    }
+    FILE* file = fopen(TRACE_FILE, "wb");
+    if (file == NULL) {
+        return;
+    }
+    unsigned int count = traceNext < TRACE_SIZE ? traceNext : TRACE_SIZE;
+    int header[2] = {TRACE_MAGIC, (int)count};
+    fwrite(header, sizeof(int), 2, file);
+    for (unsigned int i = traceNext - count; i != traceNext; i++) {
+        fwrite(&traceBuffer[i & (TRACE_SIZE - 1)], sizeof(TraceRecord), 1, file);
+    }
+    fclose(file);
+}
+
+/**
+ * This function halts the simulation after writing out the scheduler trace.
+ * Use it in place of USLOSS_Halt for error halts.
+ * 
+ * @param status - the halt status
+ */
+void haltWithTrace(int status){
+    dumpSchedTrace();
+    USLOSS_Halt(status);
+}
+
+/**
+ * This helper function assserts that the current call is made in kernel mode.
+ * Halts the program if the call is made in user mode.
+ * 
+ * @param name - name of the function that is being called
+ */
+void assertKernelMode(char *name){
+    if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
+        USLOSS_Console("ERROR: Someone attempted to call %s while in user mode!\n", name);
+        haltWithTrace(1);
+    }
+}
+
+/**
+ * This helper function disables interrupts.
+ */
+void disableInterrupts() {
+	USLOSS_PsrSet(USLOSS_PsrGet() & ~USLOSS_PSR_CURRENT_INT);
+}
+
+/**
+ * This helper function restores interrupts.
+ */
+void restoreInterrupts() {
+	USLOSS_PsrSet(USLOSS_PsrGet() | USLOSS_PSR_CURRENT_INT);
+}
+
+/**
+ * This helper function returns the priority of the run queue a process
+ * belongs in. That is its effective priority, or the best priority lent to
+ * it if that is better.
+ * 
+ * @param process - the process
+ * 
+ * @return the priority, range from 1 to KERNEL_PRIORITIES
+ */
+int getRunLevel(Process* process){
+    for (int i = 0; i < process->effPriority - 1; i++) {
+        if (process->donations[i] > 0) {
+            return i + 1;
+        }
+    }
+    return process->effPriority;
+}
+
+/**
+ * This helper function places a process in the run queue for its run level
+ * and marks that priority as non-empty in the ready mask.
+ * 
+ * @param process - the process to be placed in the queue
+ */
+void placeInQueue(Process* process){
+    int priority = getRunLevel(process) - 1;
+    if (agingThreshold > 0) {
+        process->queuedSince = currentTime();
+    }
+    // a better priority than the running process means it should be preempted
+    if (currentProcess == NULL || priority + 1 < getRunLevel(currentProcess)) {
+        needResched = 1;
+    }
+    process->nextInQueue = NULL;
+    process->prevInQueue = runQueue[priority].tail;
+    if (runQueue[priority].head == NULL) {
+        runQueue[priority].head = process;
+        runQueue[priority].tail = process;
+        readyMask |= 1u << priority;
+    } else {
+        runQueue[priority].tail->nextInQueue = process;
+        runQueue[priority].tail = process;
+
+    }
+}
+
+/**
+ * This helper function unlinks a process from any position in the run queue
+ * and clears its priority from the ready mask once the queue is empty.
+ * Does nothing if the process is not in the queue.
+ * 
+ * @param process - the process to be removed from the queue
+ */
+void removeFromQueue(Process* process){
+    int priority = getRunLevel(process) - 1;
+    if (process->prevInQueue == NULL && runQueue[priority].head != process) {
+        return;
+    }
+    if (process->prevInQueue != NULL) {
+        process->prevInQueue->nextInQueue = process->nextInQueue;
+    } else {
+        runQueue[priority].head = process->nextInQueue;
+    }
+    if (process->nextInQueue != NULL) {
+        process->nextInQueue->prevInQueue = process->prevInQueue;
+    } else {
+        runQueue[priority].tail = process->prevInQueue;
+    }
+    // if the process was the only one in the queue
+    if (runQueue[priority].head == NULL) {
+        readyMask &= ~(1u << priority);
+    }
+    process->nextInQueue = NULL;
+    process->prevInQueue = NULL;
+}
+
+/**
+ * This helper function appends an event to the scheduler trace ring buffer.
+ * Interrupts are disabled in every caller, so no locking is needed.
+ * 
+ * @param event - one of the TRACE_ events
+ * @param pid - the process the event is about
+ * @param arg - the event detail, see schedtrace.h
+ */
+void traceEvent(int event, int pid, int arg){
+    if (!traceEnabled) {
+        return;
+    }
+    TraceRecord* record = &traceBuffer[traceNext & (TRACE_SIZE - 1)];
+    record->time = currentTime();
+    record->event = event;
+    record->pid = pid;
+    record->arg = arg;
+    traceNext++;
+}
+
+/**
+ * This function turns recording of scheduler events on or off.
+ * 
+ * @param enable - 1 to record events, 0 to stop
+ */
+void setSchedTrace(int enable){
+    assertKernelMode("setSchedTrace");
+    traceEnabled = enable;
+}
+
+/**
+ * This helper function checks whether a status is one of the blocked states.
+ * 
+ * @param status - the status
+ * 
+ * @return 1 if the status is blocked, else 0
+ */
+int isBlockedStatus(int status){
+    return status == BLOCKED || status == BLOCKED_ON_JOIN || status == BLOCKED_ON_ZAP;
+}
+
+/**
+ * This helper function changes the status of a process and charges the time
+ * spent in the old status to its waiting or blocked total. Running time is
+ * charged separately by switchTo. The dispatcher has to run once the current
+ * process blocks or quits.
+ * 
+ * @param process - the process
+ * @param status - the new status
+ */
+void setStatus(Process* process, int status){
+    int now = currentTime();
+    if (process->status == RUNNABLE) {
+        process->waitTime += now - process->stateSince;
+    } else if (isBlockedStatus(process->status)) {
+        process->blockedTime += now - process->stateSince;
+    }
+    if (isBlockedStatus(status) && !isBlockedStatus(process->status)) {
+        traceEvent(TRACE_BLOCK, process->pid, status);
+    } else if (status == RUNNABLE && isBlockedStatus(process->status)) {
+        traceEvent(TRACE_UNBLOCK, process->pid, process->status);
+    }
+    if (process == currentProcess && status != RUNNING && status != RUNNABLE) {
+        needResched = 1;
+    }
+    process->status = status;
+    process->stateSince = now;
+}
+
+/**
+ * This helper function calls the dispatcher only if a process with a better
+ * priority became runnable or the current process stopped running.
+ */
+void reschedule(){
+    if (needResched) {
+        dispatcher();
+    } else {
+        dispatchesAvoided++;
+    }
+}
+
+/**
+ * This function reports how often the dispatcher ran and how often it was skipped.
+ * 
+ * @param dispatches - set to the number of full dispatcher passes
+ * @param avoided - set to the number of dispatcher calls that were skipped
+ */
+void getDispatchStats(int *dispatches, int *avoided){
+    *dispatches = dispatchCount;
+    *avoided = dispatchesAvoided;
+}
+
+/**
+ * This helper function returns the time slice of a process, which depends on
+ * the priority of the run queue it is in.
+ * 
+ * @param process - the process
+ * 
+ * @return the time slice in microseconds
+ */
+int getQuantum(Process* process){
+    return quantumTable[getRunLevel(process) - 1];
+}
+
+/**
+ * This function sets the time slice for one priority.
+ * 
+ * @param priority - the priority, range from 1 to KERNEL_PRIORITIES
+ * @param quantum - the time slice in microseconds
+ * 
+ * @return -1 if the priority is out of range or quantum is not positive, else 0
+ */
+int setQuantum(int priority, int quantum){
+    assertKernelMode("setQuantum");
+    if (priority < 1 || priority > KERNEL_PRIORITIES || quantum <= 0) {
+        return -1;
+    }
+    quantumTable[priority - 1] = quantum;
+    return 0;
+}
+
+/**
+ * This helper function promotes every runnable process that has waited in its
+ * queue for agingThreshold time slices by one priority level. Queues are in
+ * placement order, so only the processes at the front need to be checked.
+ * Priority 1 cannot improve and init at priority KERNEL_PRIORITIES never ages.
+ */
+void ageProcesses(){
+    int now = currentTime();
+    for (int i = 1; i < LOWEST_PRIORITY; i++) {
+        int limit = agingThreshold * quantumTable[i];
+        Process* process = runQueue[i].head;
+        if (process == currentProcess) {
+            process = process->nextInQueue;
+        }
+        while (process != NULL && now - process->queuedSince >= limit) {
+            Process* next = process->nextInQueue;
+            removeFromQueue(process);
+            process->effPriority--;
+            placeInQueue(process);
+            process = next;
+        }
+    }
+}
+
+/**
+ * This function sets how many time slices a runnable process waits before
+ * its priority is improved by one level.
+ * 
+ * @param quanta - the aging threshold, 0 to disable aging
+ * 
+ * @return -1 if quanta is negative, else 0
+ */
+int setAgingThreshold(int quanta){
+    assertKernelMode("setAgingThreshold");
+    if (quanta < 0) {
+        return -1;
+    }
+    disableInterrupts();
+    // processes queued while aging was off start waiting now
+    if (agingThreshold == 0) {
+        int now = currentTime();
+        for (int i = 0; i < KERNEL_PRIORITIES; i++) {
+            for (Process* process = runQueue[i].head; process != NULL; process = process->nextInQueue) {
+                process->queuedSince = now;
+            }
+        }
+    }
+    agingThreshold = quanta;
+    restoreInterrupts();
+    return 0;
+}
+
+/**
+ * This helper function runs the fixed-priority policy's periodic work, which is aging.
+ */
+void fixedTick(){
+    if (agingThreshold > 0) {
+        ageProcesses();
+    }
+}
+
+/**
+ * This helper function handles a used up time slice under the fixed-priority
+ * policy. Nothing changes, the dispatcher rotates equal priority processes.
+ * 
+ * @param process - the running process
+ */
+void fixedExpired(Process* process){
+}
+
+/**
+ * This helper function puts a process switched out under the fixed-priority
+ * policy back at its base priority, which ends any aging.
+ * 
+ * @param process - the process
+ */
+void fixedPreempted(Process* process){
+    process->effPriority = process->priority;
+}
+
+/**
+ * This helper function puts a process that blocked under the fixed-priority
+ * policy back at its base priority.
+ * 
+ * @param process - the process
+ * @param ran - how long the process ran in its last time slice
+ */
+void fixedBlocked(Process* process, int ran){
+    process->effPriority = process->priority;
+}
+
+/**
+ * This helper function puts every process back at its base priority, and
+ * moves the ones in a run queue to the queue for their new level.
+ */
+void resetPriorities(){
+    for (int i = 0; i < KERNEL_MAXPROC; i++) {
+        Process* process = &processTable[i];
+        if (process->status == FREE || process->effPriority == process->priority) {
+            continue;
+        }
+        if (process->status == RUNNING || process->status == RUNNABLE) {
+            removeFromQueue(process);
+            process->effPriority = process->priority;
+            placeInQueue(process);
+        } else {
+            process->effPriority = process->priority;
+        }
+    }
+}
+
+/**
+ * This helper function boosts every process back to its base priority once
+ * per MLFQ_BOOST_PERIOD, so processes that sank to LOWEST_PRIORITY cannot starve.
+ */
+void mlfqTick(){
+    int now = currentTime();
+    if (now - lastBoost < MLFQ_BOOST_PERIOD) {
+        return;
+    }
+    lastBoost = now;
+    resetPriorities();
+}
+
+/**
+ * This helper function drops a process that used up its time slice under
+ * MLFQ one priority level, down to LOWEST_PRIORITY, and starts a new slice for it.
+ * At the lowest level it goes to the back of its queue, so processes there
+ * still take turns.
+ * 
+ * @param process - the running process
+ */
+void mlfqExpired(Process* process){
+    removeFromQueue(process);
+    if (process->effPriority < LOWEST_PRIORITY) {
+        process->effPriority++;
+    }
+    placeInQueue(process);
+    // charge the used slice before starting the new one
+    int now = currentTime();
+    process->cpuTime += now - process->quantumStart;
+    process->quantumStart = now;
+}
+
+/**
+ * This helper function keeps the level of a process preempted under MLFQ.
+ * 
+ * @param process - the process
+ */
+void mlfqPreempted(Process* process){
+}
+
+/**
+ * This helper function raises a process that blocked before using up its
+ * time slice under MLFQ one level, but never above its base priority.
+ * 
+ * @param process - the process
+ * @param ran - how long the process ran in its last time slice
+ */
+void mlfqBlocked(Process* process, int ran){
+    if (ran < getQuantum(process) && process->effPriority > process->priority) {
+        process->effPriority--;
+    }
+}
+
+SchedOps schedPolicies[] = {
+    [SCHED_FIXED] = {fixedTick, fixedExpired, fixedPreempted, fixedBlocked},
+    [SCHED_MLFQ] = {mlfqTick, mlfqExpired, mlfqPreempted, mlfqBlocked},
+};
+
+/**
+ * This function selects the scheduler policy. Levels set by the old policy,
+ * from MLFQ demotions or aging, mean nothing to the new one, so every process
+ * goes back to its base priority.
+ * 
+ * @param policy - SCHED_FIXED or SCHED_MLFQ
+ * 
+ * @return -1 if the policy is invalid, else 0
+ */
+int setSchedulerPolicy(int policy){
+    assertKernelMode("setSchedulerPolicy");
+    if (policy != SCHED_FIXED && policy != SCHED_MLFQ) {
+        return -1;
+    }
+    disableInterrupts();
+    int changed = schedOps != &schedPolicies[policy];
+    schedOps = &schedPolicies[policy];
+    lastBoost = currentTime();
+    if (changed) {
+        resetPriorities();
+        // the current process may have lost a level it only had under the old policy
+        needResched = 1;
+        reschedule();
+    }
+    restoreInterrupts();
+    return 0;
+}
+
+/**
+ * This helper function adds to or takes away from the number of processes
+ * lending a priority to a process, and moves the process to the run queue
+ * for its new run level.
+ * 
+ * @param process - the process lent to
+ * @param level - the priority lent
+ * @param delta - 1 to lend, -1 to take back
+ */
+void changeDonation(Process* process, int level, int delta){
+    if (delta < 0 && process->donations[level - 1] == 0) {
+        return;
+    }
+    int queued = process->status == RUNNING || process->status == RUNNABLE;
+    if (queued) {
+        removeFromQueue(process);
+    }
+    process->donations[level - 1] += delta;
+    if (queued) {
+        placeInQueue(process);
+    }
+    needResched = 1;
+}
+
+/**
+ * This helper function lends the current process's run level to a process
+ * it is about to block on. Does nothing unless priority inheritance is on,
+ * or if the current process already lends its priority.
+ * 
+ * @param process - the process to lend to, may be NULL
+ */
+void lendTo(Process* process){
+    if (!inheritEnabled || currentProcess->lentLevel != 0 || process == NULL ||
+        process == currentProcess || process->status == ZOMBIE) {
+        return;
+    }
+    currentProcess->lentLevel = getRunLevel(currentProcess);
+    changeDonation(process, currentProcess->lentLevel, 1);
+}
+
+/**
+ * This helper function takes back what the current process lent with lendTo.
+ * A process that quit since keeps nothing, so it is skipped.
+ * 
+ * @param process - the process lent to, may be NULL
+ */
+void revokeFrom(Process* process){
+    if (currentProcess->lentLevel == 0) {
+        return;
+    }
+    if (process != NULL && process->status != ZOMBIE) {
+        changeDonation(process, currentProcess->lentLevel, -1);
+    }
+    currentProcess->lentLevel = 0;
+}
+
+/**
+ * This helper function blocks the current process on a join. While it is
+ * blocked it lends its priority to every child that has not quit yet, so a
+ * low priority child cannot be starved by processes the parent would preempt.
+ */
+void blockJoin(){
+    setStatus(currentProcess, BLOCKED_ON_JOIN);
+    removeFromQueue(currentProcess);
+    if (inheritEnabled) {
+        currentProcess->lentLevel = getRunLevel(currentProcess);
+        for (Process* child = currentProcess->child; child != NULL; child = child->sibling) {
+            if (child->status != ZOMBIE) {
+                changeDonation(child, currentProcess->lentLevel, 1);
+            }
+        }
+    }
+    reschedule();
+    // children that quit in the meantime no longer matter
+    if (currentProcess->lentLevel != 0) {
+        for (Process* child = currentProcess->child; child != NULL; child = child->sibling) {
+            if (child->status != ZOMBIE) {
+                changeDonation(child, currentProcess->lentLevel, -1);
+            }
+        }
+        currentProcess->lentLevel = 0;
+    }
+}
+
+/**
+ * This helper function adds a process to the back of its parent's zombie list.
+ * 
+ * @param process - the process that quit
+ */
+void addZombie(Process* process){
+    Process* parent = process->parent;
+    process->nextZombie = NULL;
+    if (parent->zombieHead == NULL) {
+        parent->zombieHead = process;
+    } else {
+        parent->zombieTail->nextZombie = process;
+    }
+    parent->zombieTail = process;
+}
+
+/**
+ * This helper function removes the oldest zombie from the current process's zombie list.
+ * 
+ * @return the zombie child, or NULL if no child has quit
+ */
+Process* takeZombie(){
+    Process* zombie = currentProcess->zombieHead;
+    if (zombie != NULL) {
+        currentProcess->zombieHead = zombie->nextZombie;
+        if (currentProcess->zombieHead == NULL) {
+            currentProcess->zombieTail = NULL;
+        }
+        zombie->nextZombie = NULL;
+    }
+    return zombie;
+}
+
+/**
+ * This helper function unlinks a child from its parent's child list.
+ * 
+ * @param child - the child to be removed
+ */
+void removeChild(Process* child){
+    Process* parent = child->parent;
+    if (child->prevSibling != NULL) {
+        child->prevSibling->sibling = child->sibling;
+    } else {
+        parent->child = child->sibling;
+    }
+    if (child->sibling != NULL) {
+        child->sibling->prevSibling = child->prevSibling;
+    }
+    child->sibling = NULL;
+    child->prevSibling = NULL;
+    parent->childCount--;
+}
+
+/**
+ * This helper function makes every process that zapped the given process runnable again.
+ * 
+ * @param process - the process that quit
+ */
+void wakeZappers(Process* process){
+    Process* zapper = process->zapperHead;
+    while (zapper != NULL) {
+        Process* next = zapper->nextZapper;
+        zapper->nextZapper = NULL;
+        setStatus(zapper, RUNNABLE);
+        placeInQueue(zapper);
+        zapper = next;
+    }
+    process->zapperHead = NULL;
+}
+
+/**
+ * This helper function tells the process waiting in zapGroup that one more
+ * member of the group has quit, and makes it runnable once all of them have.
+ * 
+ * @param process - the process that quit
+ */
+void wakeGroupZapper(Process* process){
+    Process* zapper = process->groupZapper;
+    if (zapper == NULL) {
+        return;
+    }
+    process->groupZapper = NULL;
+    zapper->groupPending--;
+    if (zapper->groupPending == 0) {
+        setStatus(zapper, RUNNABLE);
+        placeInQueue(zapper);
+    }
+}
+
+/**
+ * This helper function returns the slot in the process table for the given pid.
+ * 
+ * @param pid - the pid of the process
+ * 
+ * @return slot - the slot in the process table
+ */
+int getSlot(int pid){
+    int slot = pid % KERNEL_MAXPROC;
+    return slot;
+}
+
+/**
+ * This helper function returns the process with the given pid. The slot
+ * only matches if it still holds that pid, so stale pids from an earlier
+ * generation of the slot are rejected.
+ * 
+ * @param pid - the pid of the process
+ * 
+ * @return the process, or NULL if no live process has the pid
+ */
+Process* getProcess(int pid){
+    if (pid <= 0) {
+        return NULL;
+    }
+    Process* process = &processTable[getSlot(pid)];
+    if (process->status == FREE || process->pid != pid) {
+        return NULL;
+    }
+    return process;
+}
+
+/**
+ * This function lends the current process's priority to the process with
+ * the given pid until revokePriority is called. The caller is about to
+ * block waiting for that process, for example a server that owns a mailbox.
+ * Does nothing unless priority inheritance is on, or if the pid is not a live process.
+ * 
+ * @param pid - the pid of the process to lend to
+ */
+void lendPriority(int pid){
+    assertKernelMode("lendPriority");
+    disableInterrupts();
+    lendTo(getProcess(pid));
+    restoreInterrupts();
+}
+
+/**
+ * This function takes back the priority the current process lent to the
+ * process with the given pid. Does nothing if nothing was lent.
+ * 
+ * @param pid - the pid of the process lent to
+ */
+void revokePriority(int pid){
+    assertKernelMode("revokePriority");
+    disableInterrupts();
+    revokeFrom(getProcess(pid));
+    restoreInterrupts();
+}
+
+/**
+ * This function lends the current process's priority to every process in a
+ * list until revokePriorityMany is called with the same list. The caller is
+ * about to block until any one of them acts, for example a receiver waiting
+ * on several servers' mailboxes. Does nothing unless priority inheritance is
+ * on, or if the current process already lends its priority. Pids that are
+ * not live processes are skipped.
+ * 
+ * @param pids - the pids of the processes to lend to
+ * @param count - the number of pids
+ */
+void lendPriorityMany(int *pids, int count){
+    assertKernelMode("lendPriorityMany");
+    disableInterrupts();
+    if (inheritEnabled && currentProcess->lentLevel == 0) {
+        int level = getRunLevel(currentProcess);
+        for (int i = 0; i < count; i++) {
+            Process* process = getProcess(pids[i]);
+            if (process != NULL && process != currentProcess && process->status != ZOMBIE) {
+                changeDonation(process, level, 1);
+                currentProcess->lentLevel = level;
+            }
+        }
+    }
+    restoreInterrupts();
+}
+
+/**
+ * This function takes back the priority the current process lent with
+ * lendPriorityMany. Processes that quit since keep nothing, so they are skipped.
+ * 
+ * @param pids - the pids passed to lendPriorityMany
+ * @param count - the number of pids
+ */
+void revokePriorityMany(int *pids, int count){
+    assertKernelMode("revokePriorityMany");
+    disableInterrupts();
+    if (currentProcess->lentLevel != 0) {
+        for (int i = 0; i < count; i++) {
+            Process* process = getProcess(pids[i]);
+            if (process != NULL && process != currentProcess && process->status != ZOMBIE) {
+                changeDonation(process, currentProcess->lentLevel, -1);
+            }
+        }
+        currentProcess->lentLevel = 0;
+    }
+    restoreInterrupts();
+}
+
+/**
+ * This function turns priority inheritance on or off. Priorities already
+ * lent are still taken back when the lenders wake up.
+ * 
+ * @param enable - 1 to let blocked processes lend their priority, 0 to stop
+ */
+void setPriorityInheritance(int enable){
+    assertKernelMode("setPriorityInheritance");
+    inheritEnabled = enable;
+}
+
+/**
+ * This helper function adds a slot to the back of the free slot ring.
+ * 
+ * @param slot - the slot in the process table
+ */
+void releaseSlot(int slot){
+    freeSlots[(freeSlotHead + freeSlotCount) % KERNEL_MAXPROC] = slot;
+    freeSlotCount++;
+}
+
+/**
+ * This helper function takes the oldest free slot and hands out the next pid
+ * for it. The pid is the smallest one at or after PID that maps to the slot,
+ * so pid / KERNEL_MAXPROC works as a generation that grows every time a slot is reused.
+ * The caller must make sure a slot is free.
+ * 
+ * @return the new pid
+ */
+int allocPid(){
+    int slot = freeSlots[freeSlotHead];
+    freeSlotHead = (freeSlotHead + 1) % KERNEL_MAXPROC;
+    freeSlotCount--;
+
+    int pid = PID + (slot - PID % KERNEL_MAXPROC + KERNEL_MAXPROC) % KERNEL_MAXPROC;
+    PID = pid + 1;
+    return pid;
+}
+
+/**
+ * This helper function returns the stack pool class for the given stack size.
+ * 
+ * @param stackSize - the requested stack size
+ * 
+ * @return the index of the smallest class that fits, or -1 if the size is too big to pool
+ */
+int getStackClass(int stackSize){
+    for (int i = 0; i < STACK_POOL_CLASSES; i++) {
+        if (stackSize <= stackPool[i].stackSize) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * This helper function returns how many bytes a guarded stack of the given size maps,
+ * not counting the guard page.
+ * 
+ * @param stackSize - the stack size
+ * 
+ * @return the stack size rounded up to whole pages
+ */
+int getGuardedSize(int stackSize){
+    int page = sysconf(_SC_PAGESIZE);
+    return (stackSize + page - 1) / page * page;
+}
 
 /**
- * This helper function prints the run queue.
+ * This helper function gets memory for a new stack. In guarded mode the stack is
+ * mapped right above a PROT_NONE page, so overflowing it faults instead of
+ * corrupting other memory.
+ * 
+ * @param stackSize - the stack size
+ * 
+ * @return the stack
  */
-void printRunQueue(){
-    for (int i = 0; i < 6; i++) {
-        USLOSS_Console("Priority: %d\n", i + 1);
-        Process* process = runQueue[i].head;
-        while (process != NULL) {
-            USLOSS_Console("Process: %d, next: %d\n", process->pid, process->nextInQueue == NULL ? -1 : process->nextInQueue->pid);
-            process = process->nextInQueue;
-        }
+void* newStack(int stackSize){
+    if (!stackGuard) {
+        return malloc(stackSize);
+    }
+    int page = sysconf(_SC_PAGESIZE);
+    char* base = mmap(NULL, getGuardedSize(stackSize) + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        USLOSS_Console("ERROR: could not map a stack of %d bytes.\n", stackSize);
+        haltWithTrace(1);
     }
+    // without the guard page the stack still works, it just is not protected
+    if (mprotect(base, page, PROT_NONE) != 0) {
+        USLOSS_Console("WARNING: could not protect the guard page of a stack of %d bytes, it is unguarded.\n", stackSize);
+    }
+    return base + page;
 }
 
 /**
- * This helper function assserts that the current call is made in kernel mode.
- * Halts the program if the call is made in user mode.
+ * This helper function releases the memory of a stack made by newStack.
  * 
- * @param name - name of the function that is being called
+ * @param stack - the stack
+ * @param stackSize - the size the stack was made with
  */
-void assertKernelMode(char *name){
-    if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
-        USLOSS_Console("ERROR: Someone attempted to call %s while in user mode!\n", name);
-        USLOSS_Halt(1);
+void deleteStack(void* stack, int stackSize){
+    if (!stackGuard) {
+        free(stack);
+        return;
     }
+    int page = sysconf(_SC_PAGESIZE);
+    munmap((char*)stack - page, getGuardedSize(stackSize) + page);
 }
 
 /**
- * This helper function places a process in the run queue.
+ * This helper function allocates a stack, reusing a pooled one when possible.
  * 
- * @param process - the process to be placed in the queue
+ * @param stackSize - the requested stack size
+ * 
+ * @return the stack
  */
-void placeInQueue(Process* process){
-    int priority = process->priority - 1;
-    if (runQueue[priority].head == NULL) {
-        runQueue[priority].head = process;
-        runQueue[priority].tail = process;
+void* allocStack(int stackSize){
+    void* stack;
+    int sizeClass = getStackClass(stackSize);
+    if (sizeClass >= 0 && stackPool[sizeClass].freeList != NULL) {
+        stack = stackPool[sizeClass].freeList;
+        stackPool[sizeClass].freeList = *(void**)stack;
+        stackPool[sizeClass].freeCount--;
+        stackPoolHits++;
     } else {
-        runQueue[priority].tail->nextInQueue = process;
-        runQueue[priority].tail = process;
-
+        stack = newStack(sizeClass >= 0 ? stackPool[sizeClass].stackSize : stackSize);
+        stackPoolMisses++;
     }
+    stacksInUse++;
+    if (stacksInUse > stackHighWater) {
+        stackHighWater = stacksInUse;
+    }
+    return stack;
 }
 
 /**
- * This helper function removes a process from the run queue.
+ * This helper function returns a stack to its pool, or frees it if it is too big to pool.
  * 
- * @param process - the process to be removed from the queue
+ * @param stack - the stack, may be NULL
+ * @param stackSize - the size the stack was allocated with
  */
-void removeFromQueue(Process* process){
-    int priority = process->priority - 1;
-    runQueue[priority].head = process->nextInQueue;
-    // if the process was the only one in the queue
-    if (runQueue[priority].head == NULL) {
-        runQueue[priority].tail = NULL;
+void freeStack(void* stack, int stackSize){
+    if (stack == NULL) {
+        return;
     }
-    process->nextInQueue = NULL;
+    int sizeClass = getStackClass(stackSize);
+    if (sizeClass >= 0) {
+        *(void**)stack = stackPool[sizeClass].freeList;
+        stackPool[sizeClass].freeList = stack;
+        stackPool[sizeClass].freeCount++;
+    } else {
+        deleteStack(stack, stackSize);
+    }
+    stacksInUse--;
 }
 
 /**
- * This helper function blocks the current process on a join.
+ * This helper function sets up the stack pool classes and preallocates their stacks.
  */
-void blockJoin(){
-    currentProcess->status = BLOCKED_ON_JOIN;
-    removeFromQueue(currentProcess);
-    dispatcher();
+void initStackPool(){
+    for (int i = 0; i < STACK_POOL_CLASSES; i++) {
+        stackPool[i].stackSize = USLOSS_MIN_STACK << i;
+        stackPool[i].freeList = NULL;
+        stackPool[i].freeCount = 0;
+        for (int j = 0; j < STACK_POOL_PREALLOC; j++) {
+            void* stack = newStack(stackPool[i].stackSize);
+            *(void**)stack = stackPool[i].freeList;
+            stackPool[i].freeList = stack;
+            stackPool[i].freeCount++;
+        }
+    }
+    stackPoolHits = 0;
+    stackPoolMisses = 0;
+    stacksInUse = 0;
+    stackHighWater = 0;
 }
 
 /**
- * This helper function returns the slot in the process table for the given pid.
+ * This helper function reports how much of a guarded process's stack was ever used,
+ * by finding the lowest byte that no longer holds the canary.
  * 
- * @param pid - the pid of the process
- * 
- * @return slot - the slot in the process table
+ * @param process - the process, whose stack must still be allocated
  */
-int getSlot(int pid){
-    int slot = pid % MAXPROC;
-    return slot;
+void reportStackUsage(Process* process){
+    ProcessInfo* info = getInfo(process);
+    if (!stackGuard || info->stack == NULL) {
+        return;
+    }
+    unsigned char* stack = info->stack;
+    int untouched = 0;
+    while (untouched < info->stackSize && stack[untouched] == STACK_CANARY) {
+        untouched++;
+    }
+    USLOSS_Console("Stack high-water mark for %s (pid %d): %d of %d bytes\n",
+        info->name, process->pid, info->stackSize - untouched, info->stackSize);
 }
 
 /**
- * This helper function finds the next available pid in the process table.
+ * This function reports the stack pool counters.
+ * 
+ * @param hits - set to the number of stacks reused from the pool
+ * @param misses - set to the number of stacks that had to be malloc'd
+ * @param highWater - set to the most stacks that were in use at once
  */
-void findPid(){
-    if (processCount >= MAXPROC) {
-        return;
-    }
-    while(processTable[PID % MAXPROC].status != FREE){
-        PID++;
-    }
+void getStackPoolStats(int *hits, int *misses, int *highWater){
+    *hits = stackPoolHits;
+    *misses = stackPoolMisses;
+    *highWater = stackHighWater;
 }
 
 /**
@@ -167,37 +1169,112 @@ void findPid(){
  * @param slot - the slot in the process table
  */
 void clearProcessTable(int slot){
-    free(processTable[slot].stack);
+    freeStack(processInfo[slot].stack, processInfo[slot].stackSize);
     processTable[slot].pid = 0;
     processTable[slot].status = FREE;
     processTable[slot].priority = -1;
-    processTable[slot].name[0] = '\0';
-    processTable[slot].startFunc = NULL;
-    processTable[slot].arg = NULL;
-    processTable[slot].stackSize = -1;
-    processTable[slot].stack = NULL;
+    processTable[slot].effPriority = -1;
+    memset(processTable[slot].donations, 0, sizeof(processTable[slot].donations));
+    processTable[slot].lentLevel = 0;
+    processTable[slot].queuedSince = 0;
+    processInfo[slot].name[0] = '\0';
+    processInfo[slot].startFunc = NULL;
+    processInfo[slot].arg = NULL;
+    processInfo[slot].stackSize = -1;
+    processInfo[slot].stack = NULL;
     processTable[slot].parent = NULL;
     processTable[slot].child = NULL;
     processTable[slot].sibling = NULL;
+    processTable[slot].prevSibling = NULL;
     processTable[slot].childCount = 0;
+    processTable[slot].zombieHead = NULL;
+    processTable[slot].zombieTail = NULL;
+    processTable[slot].nextZombie = NULL;
     processTable[slot].exitState = 0;
     processTable[slot].nextInQueue = NULL;
+    processTable[slot].prevInQueue = NULL;
     processTable[slot].blockStatus = 0;
+    processTable[slot].pgid = 0;
+    processTable[slot].zapped = 0;
+    processTable[slot].groupZapper = NULL;
+    processTable[slot].groupPending = 0;
+    processTable[slot].autoReap = 0;
+    processTable[slot].zapperHead = NULL;
+    processTable[slot].nextZapper = NULL;
+    processTable[slot].quantumStart = 0;
+    processTable[slot].cpuTime = 0;
+    processTable[slot].stateSince = 0;
+    processTable[slot].waitTime = 0;
+    processTable[slot].blockedTime = 0;
+    processTable[slot].switches = 0;
+    processTable[slot].voluntary = 0;
+    processTable[slot].involuntary = 0;
     processCount--;
+    releaseSlot(slot);
 }
 
 /**
- * This helper function disables interrupts.
+ * This helper function frees every auto-reaped process on the reap list
+ * except the current one, which is still running on its stack.
  */
-void disableInterrupts() {
-	USLOSS_PsrSet(USLOSS_PsrGet() & ~USLOSS_PSR_CURRENT_INT);
+void reapZombies(){
+    Process* keep = NULL;
+    while (reapHead != NULL) {
+        Process* zombie = reapHead;
+        reapHead = zombie->nextZombie;
+        if (zombie == currentProcess) {
+            keep = zombie;
+            continue;
+        }
+        clearProcessTable(getSlot(zombie->pid));
+    }
+    if (keep != NULL) {
+        keep->nextZombie = NULL;
+        reapHead = keep;
+    }
 }
 
 /**
- * This helper function restores interrupts.
+ * This function returns the current time of the USLOSS clock device.
+ * 
+ * @return the simulated time in microseconds
  */
-void restoreInterrupts() {
-	USLOSS_PsrSet(USLOSS_PsrGet() | USLOSS_PSR_CURRENT_INT);
+int currentTime(void){
+    int now = 0;
+    USLOSS_DeviceInput(USLOSS_CLOCK_DEV, 0, &now);
+    return now;
+}
+
+/**
+ * This function returns the CPU time used by the current process, including
+ * the part of its current quantum that has already run.
+ * 
+ * @return the CPU time of the current process in microseconds
+ */
+int readtime(void){
+    assertKernelMode("readtime");
+    if (currentProcess == NULL) {
+        return 0;
+    }
+    return currentProcess->cpuTime + currentTime() - currentProcess->quantumStart;
+}
+
+/**
+ * This helper function allocates the stack and initializes the context of a
+ * process that has never run.
+ * 
+ * @param process - the process about to be switched to
+ */
+void initContext(Process* process){
+    ProcessInfo* info = getInfo(process);
+    if (info->stack != NULL) {
+        return;
+    }
+    info->stack = allocStack(info->stackSize);
+    if (stackGuard) {
+        memset(info->stack, STACK_CANARY, info->stackSize);
+    }
+    russ_ContextInit(process->pid, &info->context, info->stack, info->stackSize, info->startFunc, info->arg);
 }
 
 /**
@@ -211,29 +1288,44 @@ void switchTo(int newpid){
         return;
     }
     // return if newpid is invalid
-    if (processTable[getSlot(newpid)].status == FREE) {
+    Process* newProcess = getProcess(newpid);
+    if (newProcess == NULL) {
         return;
     }   
+    initContext(newProcess);
+    traceEvent(TRACE_SWITCH, getpid(), newpid);
+    int now = currentTime();
     // switch to new process
     if (currentProcess == NULL) {
-        currentProcess = &processTable[getSlot(newpid)];
-        currentProcess->status = RUNNING;
-        USLOSS_ContextSwitch(NULL, &currentProcess->context);
+        currentProcess = newProcess;
+        setStatus(currentProcess, RUNNING);
+        currentProcess->switches++;
+        currentProcess->quantumStart = now;
+        USLOSS_ContextSwitch(NULL, &getInfo(currentProcess)->context);
         return;
     }
     // switch to new process
     Process* oldProcess = currentProcess;
-    oldProcess->nextInQueue = NULL;
+    // a preempted process goes to the back of its queue, at the
+    // level the scheduler policy picks for it
     if (oldProcess->status == RUNNING) {
         removeFromQueue(oldProcess);
-        oldProcess->status = RUNNABLE;
+        schedOps->preempted(oldProcess);
+        setStatus(oldProcess, RUNNABLE);
         placeInQueue(oldProcess);
+        oldProcess->involuntary++;
+    } else {
+        schedOps->blocked(oldProcess, now - oldProcess->quantumStart);
+        oldProcess->voluntary++;
     }
+    // charge the old process for the time it ran
+    oldProcess->cpuTime += now - oldProcess->quantumStart;
     
-    currentProcess = &processTable[getSlot(newpid)];
-    currentProcess->status = RUNNING;
-    USLOSS_ContextSwitch(&oldProcess->context, &currentProcess->context);
-    lastSwitchTime = clock();
+    currentProcess = newProcess;
+    setStatus(currentProcess, RUNNING);
+    currentProcess->switches++;
+    currentProcess->quantumStart = now;
+    USLOSS_ContextSwitch(&getInfo(oldProcess)->context, &getInfo(currentProcess)->context);
 }
 
 /**
@@ -242,69 +1334,94 @@ void switchTo(int newpid){
 void phase1_init(void) {
     assertKernelMode("phase1_init");
 
+    // Initialize the stack pool
+    stackGuard = STACK_GUARD;
+    initStackPool();
+
     // Initialize the process table
-    for (int i = 0; i < MAXPROC; i++) {
+    for (int i = 0; i < KERNEL_MAXPROC; i++) {
         clearProcessTable(i);
     }
 
     // Initialize the run queue
-    for (int i = 0; i < 6; i++) {
+    for (int i = 0; i < KERNEL_PRIORITIES; i++) {
         runQueue[i].priority = i + 1;
         runQueue[i].head = NULL;
         runQueue[i].tail = NULL;
     }
+    readyMask = 0;
+    for (int i = 0; i < KERNEL_PRIORITIES; i++) {
+        quantumTable[i] = TIME_SLICE;
+    }
+    needResched = 1;
+    traceEnabled = SCHED_TRACE;
+    traceNext = 0;
+    atexit(dumpSchedTrace);
+    dispatchCount = 0;
+    dispatchesAvoided = 0;
+    agingThreshold = AGING_THRESHOLD;
+    inheritEnabled = PRIORITY_INHERIT;
+    schedOps = &schedPolicies[SCHED_POLICY];
+    lastBoost = currentTime();
+
+    // Initialize the free slot ring so slots are handed out in pid order
+    freeSlotHead = 0;
+    freeSlotCount = 0;
+    for (int i = 1; i <= KERNEL_MAXPROC; i++) {
+        releaseSlot(i % KERNEL_MAXPROC);
+    }
 
     // Initialize the first process
     PID = 1;
     processCount = 0;
+    reapHead = NULL;
 
-    int slot = getSlot(PID);
-    processTable[slot].pid = PID;
-    processTable[slot].status = RUNNABLE;
-    processTable[slot].priority = 6;
-    strcpy(processTable[slot].name, "init");
-    processTable[slot].startFunc = &init_main;
-    processTable[slot].stackSize = USLOSS_MIN_STACK;
-    processTable[slot].stack = malloc(USLOSS_MIN_STACK);
+    int pid = allocPid();
+    int slot = getSlot(pid);
+    processTable[slot].pid = pid;
+    setStatus(&processTable[slot], RUNNABLE);
+    processTable[slot].priority = KERNEL_PRIORITIES;
+    processTable[slot].effPriority = KERNEL_PRIORITIES;
+    processTable[slot].pgid = pid;
+    strcpy(processInfo[slot].name, "init");
+    processInfo[slot].startFunc = &init_main;
+    processInfo[slot].stackSize = USLOSS_MIN_STACK;
     processCount++;
 
-    // initialize context
+    // the context is initialized when init is first dispatched
     placeInQueue(&processTable[slot]);
-    russ_ContextInit(PID, &processTable[slot].context, processTable[slot].stack, 
-    processTable[slot].stackSize, processTable[slot].startFunc, processTable[slot].arg);
-
-    PID++;
 }
 
 /**
- * This function starts up a new process, which is a child of the current process.
+ * This helper function creates a child of the current process and places it
+ * in the run queue. The caller must be in kernel mode with interrupts disabled,
+ * and decides when to call the dispatcher.
  * 
  * @param name - the name of the process to be created
  * @param startFunc - the main function for the child process
  * @param arg - the argument to be passed to the start function, may be NULL
  * @param stackSize - the size of the stack for the child process
- * @param priority - the priority of the child process, range from 1 to 5
+ * @param priority - the priority of the child process, range from 1 to LOWEST_PRIORITY
  * 
  * @return -1 if the process table is full, -2 if the stack size is too small, 
  *         -1 if the priority is out of range, -1 if the start function is NULL, 
  *         -1 if the name is NULL, -1 if the name is too long, or the pid of the 
  *          child process
  */
-int spork(char *name, int (*startFunc)(char*), char *arg, int stackSize, int priority){
-    // check if in kernel mode and disable interrupts
-    assertKernelMode("spork");
-    disableInterrupts();
-
+int createProcess(char *name, int (*startFunc)(char*), char *arg, int stackSize, int priority){
     // check stack size
     if (stackSize < USLOSS_MIN_STACK) {
         return -2;
     }
-    // check process count
-    if (processCount >= MAXPROC) {
+    // check process count, slots of auto-reaped children may still be waiting to be freed
+    if (reapHead != NULL) {
+        reapZombies();
+    }
+    if (processCount >= KERNEL_MAXPROC) {
         return -1;
     }
     // check priority range
-    if (priority < 1 || priority > 6) {
+    if (priority < 1 || priority > KERNEL_PRIORITIES) {
         return -1;
     }
     // check if startFunc is NULL or name is NULL
@@ -316,41 +1433,128 @@ int spork(char *name, int (*startFunc)(char*), char *arg, int stackSize, int pri
         return -1;
     }
 
-    findPid();
-    int slot = getSlot(PID);
+    int pid = allocPid();
+    int slot = getSlot(pid);
 
-    processTable[slot].pid = PID;
-    processTable[slot].status = RUNNABLE;
+    processTable[slot].pid = pid;
+    setStatus(&processTable[slot], RUNNABLE);
     processTable[slot].priority = priority;
-    strcpy(processTable[slot].name, name);
-    processTable[slot].startFunc = startFunc;
-    processTable[slot].arg = arg;
-    processTable[slot].stackSize = stackSize;
-    processTable[slot].stack = malloc(stackSize);
+    processTable[slot].effPriority = priority;
+    strcpy(processInfo[slot].name, name);
+    processInfo[slot].startFunc = startFunc;
+    processInfo[slot].arg = arg;
+    processInfo[slot].stackSize = stackSize;
     processTable[slot].parent = currentProcess;
+    processTable[slot].pgid = currentProcess->pgid;
     processTable[slot].sibling = NULL;
+    processTable[slot].prevSibling = NULL;
     processTable[slot].childCount = 0;
     processCount++;
 
-    // initialize context
-    russ_ContextInit(PID, &processTable[slot].context, processTable[slot].stack, processTable[slot].stackSize, processTable[slot].startFunc, processTable[slot].arg);
-    
+    // the stack and context are set up when the child is first dispatched
     placeInQueue(&processTable[slot]);
 
     // set current process
     if (currentProcess->child != NULL){
         processTable[slot].sibling = currentProcess->child;
+        currentProcess->child->prevSibling = &processTable[slot];
     }
 
     currentProcess->child = &processTable[slot];
     currentProcess->childCount++;
 
-    PID++;
+    traceEvent(TRACE_SPORK, pid, currentProcess->pid);
+    return pid;
+}
+
+/**
+ * This function starts up a new process, which is a child of the current process.
+ * 
+ * @param name - the name of the process to be created
+ * @param startFunc - the main function for the child process
+ * @param arg - the argument to be passed to the start function, may be NULL
+ * @param stackSize - the size of the stack for the child process
+ * @param priority - the priority of the child process, range from 1 to LOWEST_PRIORITY
+ * 
+ * @return -1 if the process table is full, -2 if the stack size is too small, 
+ *         -1 if the priority is out of range, -1 if the start function is NULL, 
+ *         -1 if the name is NULL, -1 if the name is too long, or the pid of the 
+ *          child process
+ */
+int spork(char *name, int (*startFunc)(char*), char *arg, int stackSize, int priority){
+    // check if in kernel mode and disable interrupts
+    assertKernelMode("spork");
+    disableInterrupts();
+
+    int pid = createProcess(name, startFunc, arg, stackSize, priority);
+    if (pid > 0) {
+        reschedule();
+    }
+
+    restoreInterrupts();
+    return pid;
+}
+
+/**
+ * This function starts up a new child of the current process in the given
+ * process group instead of the parent's.
+ * 
+ * @param name - the name of the process to be created
+ * @param startFunc - the main function for the child process
+ * @param arg - the argument to be passed to the start function, may be NULL
+ * @param stackSize - the size of the stack for the child process
+ * @param priority - the priority of the child process, range from 1 to LOWEST_PRIORITY
+ * @param pgid - the process group, or 0 to start a new group named by the child's pid
+ * 
+ * @return -1 if pgid is negative, else what spork returns
+ */
+int sporkGroup(char *name, int (*startFunc)(char*), char *arg, int stackSize, int priority, int pgid){
+    assertKernelMode("sporkGroup");
+    if (pgid < 0) {
+        return -1;
+    }
+    disableInterrupts();
+
+    int pid = createProcess(name, startFunc, arg, stackSize, priority);
+    if (pid > 0) {
+        processTable[getSlot(pid)].pgid = pgid == 0 ? pid : pgid;
+        reschedule();
+    }
+
+    restoreInterrupts();
+    return pid;
+}
 
-    dispatcher();
+/**
+ * This function starts up several children of the current process at once,
+ * under one interrupt-disabled section and with a single dispatch at the end.
+ * 
+ * @param descs - the children to create, each one's pid is set to the
+ *                child's pid or to the error spork would have returned
+ * @param count - the number of entries in descs
+ * 
+ * @return -1 if descs is NULL or count is negative, else the number of children created
+ */
+int sporkMany(SporkDesc *descs, int count){
+    assertKernelMode("sporkMany");
+    if (descs == NULL || count < 0) {
+        return -1;
+    }
+    disableInterrupts();
+
+    int created = 0;
+    for (int i = 0; i < count; i++) {
+        descs[i].pid = createProcess(descs[i].name, descs[i].startFunc, descs[i].arg, descs[i].stackSize, descs[i].priority);
+        if (descs[i].pid > 0) {
+            created++;
+        }
+    }
+    if (created > 0) {
+        reschedule();
+    }
 
     restoreInterrupts();
-    return processTable[slot].pid;
+    return created;
 }
 
 /**
@@ -374,47 +1578,27 @@ int join(int *status){
         return -2;
     }
     
-    Process* deadChild = currentProcess->child;
-    Process* toRemove = NULL;
-
-    //USLOSS_Console("Child %s state: %d\n", deadChild->name, deadChild->status);
-    // check if any children are zombies
-    while(deadChild != NULL && deadChild->status != ZOMBIE) {
-        deadChild = deadChild->sibling;
-        //USLOSS_Console("Child %s state: %d\n", deadChild->name, deadChild->status);
-    }
-    
-    // if no children are zombies, block the current process
-    if (deadChild == NULL) {
-        blockJoin();
-        // find the zombie child
-        deadChild = currentProcess->child;
-        while(deadChild->sibling != NULL && deadChild->status != ZOMBIE) {
-            deadChild = deadChild->sibling;
-        }
-    }
-
-    toRemove = deadChild;
-
-    if (currentProcess->child == toRemove) {
-        currentProcess->child = toRemove->sibling;
-    } else {
-        Process* curr = currentProcess->child;
-        while (curr->sibling != toRemove) {
-            curr = curr->sibling;
+    // if no children are zombies, block the current process until one quits,
+    // auto-reaped children may quit without leaving one
+    while (currentProcess->zombieHead == NULL) {
+        if (currentProcess->childCount == 0) {
+            restoreInterrupts();
+            return -2;
         }
-        curr->sibling = toRemove->sibling;
+        blockJoin();
     }
 
-    currentProcess->childCount--;
+    Process* toRemove = takeZombie();
+    removeChild(toRemove);
     *status = toRemove->exitState;
+    traceEvent(TRACE_JOIN, currentProcess->pid, toRemove->pid);
 
     // remove child from process table
     int removedPid = toRemove->pid;
     int slot = getSlot(toRemove->pid);
     clearProcessTable(slot);  
     
-    dispatcher();
+    reschedule();
     
     restoreInterrupts();
     return removedPid;
@@ -432,30 +1616,173 @@ void quit(int status){
     // check if current process has children
     if (currentProcess->childCount > 0) {
         USLOSS_Console("ERROR: Process pid %d called quit() while it still had children.\n", getpid());
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
     Process* parent = currentProcess->parent;
 
     if (parent == NULL) {
         USLOSS_Console("ERROR: Process pid %d called quit() with no parent.\n", getpid());
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
-    if (currentProcess->parent->status == BLOCKED_ON_JOIN) {
-        currentProcess->parent->status = RUNNABLE;
-        placeInQueue(currentProcess->parent);
-    } 
-    
-    currentProcess->status = ZOMBIE;
+    setStatus(currentProcess, ZOMBIE);
     currentProcess->exitState = status;
+    traceEvent(TRACE_QUIT, currentProcess->pid, status);
+    // the stack will not grow any further, so report it now whether or not
+    // the process is ever joined
+    reportStackUsage(currentProcess);
+    if (parent->autoReap) {
+        // the stack is still in use, the dispatcher frees it after switching away
+        removeChild(currentProcess);
+        currentProcess->nextZombie = reapHead;
+        reapHead = currentProcess;
+    } else {
+        addZombie(currentProcess);
+    }
+    if (parent->status == BLOCKED_ON_JOIN && (!parent->autoReap || parent->childCount == 0)) {
+        setStatus(parent, RUNNABLE);
+        placeInQueue(parent);
+    }
+    wakeZappers(currentProcess);
+    wakeGroupZapper(currentProcess);
     
     removeFromQueue(currentProcess);
-    dispatcher();
+    reschedule();
     
     restoreInterrupts();
 }
 
+/**
+ * This function asks the process with the given pid to quit and blocks until it does.
+ * Halts the program if the target is the current process, init, does not exist, or
+ * has already quit.
+ * 
+ * @param pid - the pid of the process to zap
+ */
+void zap(int pid){
+    assertKernelMode("zap");
+    disableInterrupts();
+
+    if (pid == getpid()) {
+        USLOSS_Console("ERROR: Attempt to zap() itself.\n");
+        haltWithTrace(1);
+    }
+    if (pid == 1) {
+        USLOSS_Console("ERROR: Attempt to zap() init.\n");
+        haltWithTrace(1);
+    }
+    Process* target = getProcess(pid);
+    if (target == NULL) {
+        USLOSS_Console("ERROR: Attempt to zap() a non-existent process.\n");
+        haltWithTrace(1);
+    }
+    if (target->status == ZOMBIE) {
+        USLOSS_Console("ERROR: Attempt to zap() a process that is already in the process of dying.\n");
+        haltWithTrace(1);
+    }
+
+    target->zapped = 1;
+    currentProcess->nextZapper = target->zapperHead;
+    target->zapperHead = currentProcess;
+
+    setStatus(currentProcess, BLOCKED_ON_ZAP);
+    removeFromQueue(currentProcess);
+    lendTo(target);
+    reschedule();
+    // the target may have quit and its slot been reused, so look it up by pid again
+    revokeFrom(getProcess(pid));
+
+    restoreInterrupts();
+}
+
+/**
+ * This function checks whether the current process has been zapped.
+ * 
+ * @return 1 if the current process has been zapped, else 0
+ */
+int isZapped(void){
+    assertKernelMode("isZapped");
+    if (currentProcess == NULL) {
+        return 0;
+    }
+    return currentProcess->zapped;
+}
+
+/**
+ * This function zaps every descendant of the current process in the given
+ * process group and blocks until all of them have quit. The subtree is walked
+ * once through the child and sibling links. Members that already quit, or
+ * that another process is already waiting for in zapGroup, are skipped.
+ * 
+ * @param pgid - the process group
+ * 
+ * @return -1 if pgid is not positive, else the number of processes zapped
+ */
+int zapGroup(int pgid){
+    assertKernelMode("zapGroup");
+    if (pgid <= 0) {
+        return -1;
+    }
+    disableInterrupts();
+
+    int count = 0;
+    Process* process = currentProcess->child;
+    while (process != NULL) {
+        if (process->pgid == pgid && process->status != ZOMBIE && process->groupZapper == NULL) {
+            process->zapped = 1;
+            process->groupZapper = currentProcess;
+            count++;
+        }
+        // depth first, then the next sibling of the closest ancestor that has one
+        if (process->child != NULL) {
+            process = process->child;
+            continue;
+        }
+        while (process != currentProcess && process->sibling == NULL) {
+            process = process->parent;
+        }
+        process = process == currentProcess ? NULL : process->sibling;
+    }
+
+    if (count > 0) {
+        currentProcess->groupPending = count;
+        setStatus(currentProcess, BLOCKED_ON_ZAP);
+        removeFromQueue(currentProcess);
+        reschedule();
+    }
+
+    restoreInterrupts();
+    return count;
+}
+
+/**
+ * This function returns the process group of the process with the given pid.
+ * 
+ * @param pid - the pid of the process
+ * 
+ * @return -1 if no live process has the pid, else its process group
+ */
+int getPgid(int pid){
+    assertKernelMode("getPgid");
+    Process* process = getProcess(pid);
+    if (process == NULL) {
+        return -1;
+    }
+    return process->pgid;
+}
+
+/**
+ * This function makes the current process's children be reaped as soon as
+ * they quit, so they never need to be joined. join still returns children
+ * that quit before this was turned on, and returns -2 once none are left.
+ * 
+ * @param enable - 1 to reap children automatically, 0 to join them again
+ */
+void setAutoReap(int enable){
+    assertKernelMode("setAutoReap");
+    currentProcess->autoReap = enable;
+}
 
 /**
  * This function returns the pid of the current process.
@@ -475,16 +1802,18 @@ int getpid(void){
  */
 void dumpProcesses(void){
     USLOSS_Console(" PID  PPID  NAME              PRIORITY  STATE\n");
-    for (int i = 0; i < MAXPROC; i++) {
+    for (int i = 0; i < KERNEL_MAXPROC; i++) {
         Process *slot = &processTable[i];
         if (slot->status == FREE) {
             continue;
         }
-        USLOSS_Console("%4d  %4d  %-17s %-8d  ", slot->pid, slot->parent == NULL ? 0 : slot->parent->pid, slot->name, slot->priority);
+        USLOSS_Console("%4d  %4d  %-17s %-8d  ", slot->pid, slot->parent == NULL ? 0 : slot->parent->pid, processInfo[i].name, slot->priority);
         if (slot->status == ZOMBIE) {
             USLOSS_Console("Terminated(%d)\n", slot->exitState);
         } else if (slot->status == BLOCKED_ON_JOIN) {
             USLOSS_Console("Blocked(waiting for child to quit)\n");
+        } else if (slot->status == BLOCKED_ON_ZAP) {
+            USLOSS_Console("Blocked(waiting for zap target to quit)\n");
         }
         else if (slot->status == BLOCKED) {
             USLOSS_Console("Blocked(%d)\n", slot->blockStatus);
@@ -495,6 +1824,55 @@ void dumpProcesses(void){
     }
 }
 
+/**
+ * This function fills the caller's buffer with the scheduling statistics of
+ * every process in the process table. Time spent in the current state so far
+ * is included.
+ * 
+ * @param buffer - the array to fill
+ * @param maxEntries - the number of entries in buffer
+ * 
+ * @return -1 if buffer is NULL or maxEntries is negative, else the number of entries filled
+ */
+int getProcessStats(ProcessStats *buffer, int maxEntries){
+    assertKernelMode("getProcessStats");
+    if (buffer == NULL || maxEntries < 0) {
+        return -1;
+    }
+    disableInterrupts();
+
+    int now = currentTime();
+    int count = 0;
+    for (int i = 0; i < KERNEL_MAXPROC && count < maxEntries; i++) {
+        Process *process = &processTable[i];
+        if (process->status == FREE) {
+            continue;
+        }
+        ProcessStats *entry = &buffer[count++];
+        entry->pid = process->pid;
+        entry->ppid = process->parent == NULL ? 0 : process->parent->pid;
+        entry->priority = process->priority;
+        entry->status = process->status;
+        strcpy(entry->name, processInfo[i].name);
+        entry->switches = process->switches;
+        entry->voluntary = process->voluntary;
+        entry->involuntary = process->involuntary;
+        entry->cpuTime = process->cpuTime;
+        entry->waitTime = process->waitTime;
+        entry->blockedTime = process->blockedTime;
+        if (process == currentProcess) {
+            entry->cpuTime += now - process->quantumStart;
+        } else if (process->status == RUNNABLE) {
+            entry->waitTime += now - process->stateSince;
+        } else if (process->status != ZOMBIE) {
+            entry->blockedTime += now - process->stateSince;
+        }
+    }
+
+    restoreInterrupts();
+    return count;
+}
+
 /**
  * This function blocks the current process with the given block status.
  * 
@@ -506,12 +1884,12 @@ void blockMe(int block_status){
 
     if (block_status <= 10){
         USLOSS_Console("ERROR: block_status must be greater than 10.\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
-    currentProcess->status = BLOCKED;
+    setStatus(currentProcess, BLOCKED);
     currentProcess->blockStatus = block_status;
     removeFromQueue(currentProcess);
-    dispatcher();
+    reschedule();
 
     restoreInterrupts();
 }
@@ -529,15 +1907,14 @@ int unblockProc(int pid){
     assertKernelMode("unblockProc");
     disableInterrupts();
 
-    int slot = getSlot(pid);
-    Process* process = &processTable[slot];
-    if (process->status == FREE || process->status != BLOCKED || process->blockStatus <= 10) {
+    Process* process = getProcess(pid);
+    if (process == NULL || process->status != BLOCKED || process->blockStatus <= 10) {
         return -2;
     }
-    process->status = RUNNABLE;
+    setStatus(process, RUNNABLE);
     process->blockStatus = 0;
     placeInQueue(process);
-    dispatcher();
+    reschedule();
 
     restoreInterrupts();
     return 0;
@@ -547,37 +1924,64 @@ int unblockProc(int pid){
  * This function decides which process to run next.
  */
 void dispatcher(void){
-    // find the highest priority process
     disableInterrupts();
-    int i = 0;
-    while(runQueue[i].head == NULL && i < 6){
-        i++;
+    if (reapHead != NULL) {
+        reapZombies();
     }
-    Process* highestPriority = runQueue[i].head;
-    
-    if (highestPriority == NULL) {
+    // nothing to do if no better process became runnable and the time slice is not used up
+    int sliceUsed = currentProcess != NULL && currentProcess->status == RUNNING &&
+        currentTime() - currentProcess->quantumStart >= getQuantum(currentProcess);
+    if (!needResched && !sliceUsed) {
+        dispatchesAvoided++;
+        restoreInterrupts();
+        return;
+    }
+    dispatchCount++;
+
+    schedOps->tick();
+    if (sliceUsed) {
+        schedOps->expired(currentProcess);
+    }
+    needResched = 0;
+
+    // find the highest priority process, the lowest set bit of the ready mask
+    if (readyMask == 0) {
         USLOSS_Console("ERROR: dispatcher() called with no runnable processes.\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
+    Process* highestPriority = runQueue[__builtin_ctz(readyMask)].head;
+
     if (currentProcess == NULL){
-        if (highestPriority->priority == 6){switchTo(highestPriority->pid); return;}
+        if (highestPriority->priority == KERNEL_PRIORITIES){switchTo(highestPriority->pid); return;}
         else { 
-            USLOSS_Console("ERROR: dispatcher() called while current process is NULL and highest priority is not 6.\n");
-            USLOSS_Halt(1);
+            USLOSS_Console("ERROR: dispatcher() called while current process is NULL and highest priority is not %d.\n", KERNEL_PRIORITIES);
+            haltWithTrace(1);
         }
     }
         
-    double timeElapsed = (clock() - lastSwitchTime) / (double) CLOCKS_PER_SEC * 1000;
+    int timeElapsed = currentTime() - currentProcess->quantumStart;
     
     if (highestPriority->pid != currentProcess->pid) {
         switchTo(highestPriority->pid);
     }
 
-    // if processes with same priority, switch if it has been more than 80ms
-    else if (highestPriority->nextInQueue != NULL && timeElapsed > 80) {
+    // if processes with same priority, switch if the time slice has been used up
+    else if (highestPriority->nextInQueue != NULL && timeElapsed >= getQuantum(currentProcess)) {
         switchTo(highestPriority->nextInQueue->pid);
     }
     restoreInterrupts();
 }
 
+/**
+ * This function is called by the clock interrupt handler and calls the
+ * dispatcher once the current process has used up the time slice of its priority.
+ */
+void timeSlice(void){
+    if (currentProcess == NULL) {
+        return;
+    }
+    if (currentTime() - currentProcess->quantumStart >= getQuantum(currentProcess)) {
+        dispatcher();
+    }
+}
 
@@ -0,0 +1,87 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: phase1ext.h
+ * Description: Kernel functions and types provided by phase1b-new.c on top of
+ *              the ones declared in phase1.h.
+ */
+
+#ifndef PHASE1EXT_H
+#define PHASE1EXT_H
+
+#include "phase1.h"
+#include "kernelconfig.h"
+#include "schedtrace.h"
+
+// process states reported in ProcessStats
+#define PROC_RUNNABLE 0
+#define PROC_RUNNING 1
+#define PROC_ZOMBIE 2
+#define PROC_BLOCKED_ON_JOIN 3
+#define PROC_FREE 4
+#define PROC_BLOCKED 5
+#define PROC_BLOCKED_ON_ZAP 6
+
+// scheduler policies for setSchedulerPolicy
+#define SCHED_FIXED 0 // strict priority with round robin, optionally with aging
+#define SCHED_MLFQ 1 // multi-level feedback queue bounded by each process's priority
+
+/**
+ * Struct to represent a snapshot of one process's scheduling statistics.
+ * 
+ * All times are in microseconds of simulated time.
+ */
+typedef struct ProcessStats {
+    int pid;
+    int ppid;
+    int priority;
+    int status; // one of the PROC_ states
+    char name[MAXNAME];
+    int switches; // times the process was switched in
+    int voluntary; // times it gave up the CPU by blocking or quitting
+    int involuntary; // times it was preempted while still runnable
+    int cpuTime; // time spent running
+    int waitTime; // time spent runnable but not running
+    int blockedTime; // time spent blocked
+} ProcessStats;
+
+/**
+ * Struct to describe one child for sporkMany.
+ * 
+ * The first five fields are the arguments spork takes, pid is filled in.
+ */
+typedef struct SporkDesc {
+    char *name;
+    int (*startFunc)(char*);
+    char *arg;
+    int stackSize;
+    int priority;
+    int pid; // the child's pid, or the error spork would have returned
+} SporkDesc;
+
+int currentTime(void);
+int readtime(void);
+void timeSlice(void);
+void zap(int pid);
+int isZapped(void);
+void getStackPoolStats(int *hits, int *misses, int *highWater);
+int getProcessStats(ProcessStats *buffer, int maxEntries);
+int setAgingThreshold(int quanta);
+int setSchedulerPolicy(int policy);
+void getDispatchStats(int *dispatches, int *avoided);
+int sporkMany(SporkDesc *descs, int count);
+int setQuantum(int priority, int quantum);
+void setSchedTrace(int enable);
+void dumpSchedTrace(void);
+void haltWithTrace(int status);
+void lendPriority(int pid);
+void revokePriority(int pid);
+void lendPriorityMany(int *pids, int count);
+void revokePriorityMany(int *pids, int count);
+void setPriorityInheritance(int enable);
+int sporkGroup(char *name, int (*startFunc)(char*), char *arg, int stackSize, int priority, int pgid);
+int zapGroup(int pgid);
+int getPgid(int pid);
+void setAutoReap(int enable);
+
+#endif
@@ -0,0 +1,40 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: phase2ext.h
+ * Description: Mailbox functions provided by phase2kavin.c on top of the ones
+ *              declared in phase2.h.
+ */
+
+#ifndef PHASE2EXT_H
+#define PHASE2EXT_H
+
+#include "phase2.h"
+#include "kernelconfig.h"
+
+// flags for MboxCreateFlags
+#define MBOX_ZEROCOPY 1 // messages are kernel buffers handed over by reference
+
+#define MBOX_RECV_ANY_MAX 16 // most mailboxes one MboxRecvAny call can wait on
+
+/*
+ * Zero-copy mailboxes pass kernel buffers from MboxBufferAlloc instead of
+ * copying messages into slots. MboxSendBuffer hands the buffer over to the
+ * mailbox, and the sender must not touch it again once the send returns 0.
+ * MboxRecvBuffer gives the receiver the buffer, which the receiver owns until
+ * it calls MboxBufferRelease. If a send fails, the sender still owns the buffer.
+ * Zero-copy mailboxes only accept the buffer calls, and other mailboxes
+ * reject them.
+ */
+int MboxSetOwner(int mailboxID, int pid);
+void MboxGetSlotStats(int *inUse, int *highWater);
+int MboxGetStats(int mailboxID, int *used, int *peak);
+int MboxCreateFlags(int numSlots, int slotSize, int flags);
+void *MboxBufferAlloc(void);
+void MboxBufferRelease(void *buffer);
+int MboxSendBuffer(int mailboxID, void *buffer, int size);
+int MboxCondSendBuffer(int mailboxID, void *buffer, int size);
+int MboxRecvBuffer(int mailboxID, void **buffer);
+int MboxRecvAny(int mailboxIDs[], int count, void *msg, int maxSize, int *readyID);
+
+#endif
@@ -1,8 +1,10 @@
 #include <phase1.h>
+#include <phase1ext.h>     // timeSlice, currentTime, priority lending, haltWithTrace
 #include <usloss.h>
 #include <string.h>
 #include <stdlib.h>
 #include "phase2.h"
+#include "phase2ext.h"
 
 #define CLOCK_MB     0
 #define TERM_MB_BASE 1        
@@ -18,6 +20,8 @@ static void terminal_handler(int type, void *arg);
 static void syscallHandler(int type, void *arg);
 static void nullsys(USLOSS_Sysargs *args);
 
+struct WaitEntry;
+
 typedef struct Phase2Proc {
     int pid;                    
     int status;                  
@@ -26,17 +30,43 @@ typedef struct Phase2Proc {
     int msgSize;                
     int isBlocked;              
     struct Phase2Proc *nextProc; 
+    struct WaitEntry *waits;    // entries of a process blocked in MboxRecvAny
+    int waitCount;
 } Phase2Proc;
 
-static Phase2Proc P2_ProcTable[MAXPROC];
+static Phase2Proc P2_ProcTable[KERNEL_MAXPROC];
+
+// Slots are split into size classes, each with its own storage in slotArena
+#define SLOT_CLASSES 4
+#define SLOT_TOTAL (KERNEL_SLOTS_0 + KERNEL_SLOTS_8 + KERNEL_SLOTS_64 + KERNEL_SLOTS_MAX)
+#define SLOT_ARENA_SIZE (KERNEL_SLOTS_8 * 8 + KERNEL_SLOTS_64 * 64 + KERNEL_SLOTS_MAX * MAX_MESSAGE)
+
+// The largest class is the last resort for every mailbox
+#if KERNEL_SLOTS_MAX < 1
+#error "KERNEL_SLOTS_MAX must be at least 1"
+#endif
 
 typedef struct MailSlot {
-    int id;
-    char message[MAX_MESSAGE];
+    int slotClass;              // -1 while the slot is free
     int messageSize;
     struct MailSlot *next;
 } MailSlot;
 
+typedef struct MboxBuffer {
+    char data[KERNEL_MBOX_BUFFER_SIZE];   // must stay first, callers only see data
+    int size;
+    int inUse;
+    struct MboxBuffer *next;
+} MboxBuffer;
+
+// One mailbox a process blocked in MboxRecvAny waits on, lives on its stack
+typedef struct WaitEntry {
+    Phase2Proc *proc;
+    struct Mailbox *mbox;
+    struct WaitEntry *next;
+    struct WaitEntry *prev;
+} WaitEntry;
+
 typedef struct ProcessQueue {
     Phase2Proc *head;
     Phase2Proc *tail;
@@ -46,19 +76,206 @@ typedef struct Mailbox {
     int id;
     int numSlots;
     int slotSize;
+    int slotClass;              // smallest slot class that holds slotSize bytes
     int usedSlots;
     MailSlot *slots_head;
     int isReleased;
     ProcessQueue producerQueue;
     ProcessQueue consumerQueue;
     MailSlot *slots_tail;
+    int ownerPid;               // server that serves this mailbox, 0 if none
+    int peakSlots;              // most slots this mailbox has held at once
+    int flags;                  // MBOX_ flags given at creation
+    MboxBuffer *buffers_head;   // queued messages of a zero-copy mailbox
+    MboxBuffer *buffers_tail;
+    WaitEntry *anyHead;         // processes waiting in MboxRecvAny, oldest first
+    WaitEntry *anyTail;
 } Mailbox;
 
-static Mailbox mailboxes[MAXMBOX];
-static MailSlot mailSlots[MAXSLOTS];
+static Mailbox mailboxes[KERNEL_MAXMBOX];
+static MailSlot mailSlots[SLOT_TOTAL];
+static char slotArena[SLOT_ARENA_SIZE];
+static const int slotClassSize[SLOT_CLASSES] = {0, 8, 64, MAX_MESSAGE};
+static const int slotClassCount[SLOT_CLASSES] = {KERNEL_SLOTS_0, KERNEL_SLOTS_8, KERNEL_SLOTS_64, KERNEL_SLOTS_MAX};
+static int slotClassFirst[SLOT_CLASSES];     // index in mailSlots of each class's first slot
+static char *slotClassArena[SLOT_CLASSES];   // start of each class's storage
+static MailSlot *freeSlotLists[SLOT_CLASSES]; // LIFO lists of free slots, threaded through next
+static int slotsInUse;
+static int slotsHighWater;      // most slots in use at once
+static MboxBuffer mboxBuffers[KERNEL_MBOX_BUFFERS];
+static MboxBuffer *freeBufferList;
 
 static Phase2Proc *getProc(int pid) {
-    return &P2_ProcTable[pid % MAXPROC];
+    return &P2_ProcTable[pid % KERNEL_MAXPROC];
+}
+
+static int getSlotClass(int size) {
+    for (int i = 0; i < SLOT_CLASSES; i++) {
+        if (size <= slotClassSize[i]) {
+            return i;
+        }
+    }
+    return SLOT_CLASSES - 1;
+}
+
+static char *slotMessage(MailSlot *slot) {
+    int c = slot->slotClass;
+    return slotClassArena[c] + (slot - &mailSlots[slotClassFirst[c]]) * slotClassSize[c];
+}
+
+// Takes a slot of the given class off its free list, or of the next larger
+// class that has one, returns NULL if every slot is in use
+static MailSlot *allocSlot(int slotClass) {
+    if (slotsInUse >= KERNEL_MAXSLOTS) {
+        return NULL;
+    }
+    int c = slotClass;
+    while (c < SLOT_CLASSES && freeSlotLists[c] == NULL) {
+        c++;
+    }
+    if (c == SLOT_CLASSES) {
+        return NULL;
+    }
+    MailSlot *slot = freeSlotLists[c];
+    freeSlotLists[c] = slot->next;
+    slot->slotClass = c;
+    slot->next = NULL;
+    slotsInUse++;
+    if (slotsInUse > slotsHighWater) {
+        slotsHighWater = slotsInUse;
+    }
+    return slot;
+}
+
+static void freeSlot(MailSlot *slot) {
+    int c = slot->slotClass;
+    slot->slotClass = -1;
+    slot->next = freeSlotLists[c];
+    freeSlotLists[c] = slot;
+    slotsInUse--;
+}
+
+// Appends a message to the mailbox's slot queue, returns -2 if no slot is free
+static int queueMessage(Mailbox *mbox, void *msg, int msgSize) {
+    MailSlot *slot = allocSlot(mbox->slotClass);
+    if (slot == NULL) {
+        return -2;
+    }
+    memcpy(slotMessage(slot), msg, msgSize);
+    slot->messageSize = msgSize;
+
+    // Add to end of queue
+    if (mbox->slots_head == NULL) {
+        mbox->slots_head = slot;
+        mbox->slots_tail = slot;
+    } else {
+        mbox->slots_tail->next = slot;
+        mbox->slots_tail = slot;
+    }
+    mbox->usedSlots++;
+    if (mbox->usedSlots > mbox->peakSlots) {
+        mbox->peakSlots = mbox->usedSlots;
+    }
+    return 0;
+}
+
+static void addWait(WaitEntry *entry) {
+    Mailbox *mbox = entry->mbox;
+    entry->next = NULL;
+    entry->prev = mbox->anyTail;
+    if (mbox->anyHead == NULL) {
+        mbox->anyHead = entry;
+    } else {
+        mbox->anyTail->next = entry;
+    }
+    mbox->anyTail = entry;
+}
+
+// Unlinks every entry of a process blocked in MboxRecvAny, so the other
+// mailboxes it waited on forget it as soon as one of them is ready
+static void removeWaits(Phase2Proc *proc) {
+    for (int i = 0; i < proc->waitCount; i++) {
+        WaitEntry *entry = &proc->waits[i];
+        Mailbox *mbox = entry->mbox;
+        if (entry->prev != NULL) {
+            entry->prev->next = entry->next;
+        } else {
+            mbox->anyHead = entry->next;
+        }
+        if (entry->next != NULL) {
+            entry->next->prev = entry->prev;
+        } else {
+            mbox->anyTail = entry->prev;
+        }
+    }
+    proc->waits = NULL;
+    proc->waitCount = 0;
+}
+
+// Hands a message straight to the oldest process waiting for the mailbox in
+// MboxRecvAny. Returns 0 if it was delivered, -1 if it is too big for that
+// process, or -2 if nobody waits
+static int deliverToAny(Mailbox *mbox, void *msg, int msgSize) {
+    if (mbox->anyHead == NULL) {
+        return -2;
+    }
+    Phase2Proc *receiver = mbox->anyHead->proc;
+    if (msgSize > receiver->msgSize) {
+        return -1;
+    }
+    removeWaits(receiver);
+    memcpy(receiver->msgPtr, msg, msgSize);
+    receiver->status = msgSize;
+    receiver->mboxID = mbox->id;
+    unblockProc(receiver->pid);
+    return 0;
+}
+
+// Returns the buffer whose data the pointer is, or NULL if it is not an
+// allocated kernel buffer
+static MboxBuffer *getBuffer(void *data) {
+    char *base = (char *) mboxBuffers;
+    char *ptr = (char *) data;
+    if (ptr < base || ptr >= base + sizeof(mboxBuffers) || (ptr - base) % sizeof(MboxBuffer) != 0) {
+        return NULL;
+    }
+    MboxBuffer *buffer = (MboxBuffer *) ptr;
+    return buffer->inUse ? buffer : NULL;
+}
+
+static void freeBuffer(MboxBuffer *buffer) {
+    buffer->inUse = 0;
+    buffer->next = freeBufferList;
+    freeBufferList = buffer;
+}
+
+// Appends a buffer to a zero-copy mailbox's message queue
+static void queueBuffer(Mailbox *mbox, MboxBuffer *buffer) {
+    buffer->next = NULL;
+    if (mbox->buffers_head == NULL) {
+        mbox->buffers_head = buffer;
+    } else {
+        mbox->buffers_tail->next = buffer;
+    }
+    mbox->buffers_tail = buffer;
+    mbox->usedSlots++;
+    if (mbox->usedSlots > mbox->peakSlots) {
+        mbox->peakSlots = mbox->usedSlots;
+    }
+}
+
+static MboxBuffer *dequeueBuffer(Mailbox *mbox) {
+    MboxBuffer *buffer = mbox->buffers_head;
+    if (buffer == NULL) {
+        return NULL;
+    }
+    mbox->buffers_head = buffer->next;
+    if (mbox->buffers_head == NULL) {
+        mbox->buffers_tail = NULL;
+    }
+    buffer->next = NULL;
+    mbox->usedSlots--;
+    return buffer;
 }
 
 static void initProc(Phase2Proc *proc) {
@@ -69,6 +286,8 @@ static void initProc(Phase2Proc *proc) {
     proc->msgSize = 0;
     proc->isBlocked = 0;
     proc->nextProc = NULL;
+    proc->waits = NULL;
+    proc->waitCount = 0;
 }
 
 static void enqueueProcess(ProcessQueue *queue, Phase2Proc *proc) {
@@ -95,17 +314,79 @@ static Phase2Proc *dequeueProcess(ProcessQueue *queue) {
     return proc;
 }
 
+// Completes the send of the oldest blocked producer and wakes it. Its message
+// goes into the given slot, which the caller reserved for it by not freeing
+// it, or nowhere if slot is NULL because the consumer already took it
+static void completeProducer(Mailbox *mbox, MailSlot *slot) {
+    Phase2Proc *sender = dequeueProcess(&mbox->producerQueue);
+    if (slot != NULL) {
+        memcpy(slotMessage(slot), sender->msgPtr, sender->msgSize);
+        slot->messageSize = sender->msgSize;
+        slot->next = NULL;
+        if (mbox->slots_head == NULL) {
+            mbox->slots_head = slot;
+        } else {
+            mbox->slots_tail->next = slot;
+        }
+        mbox->slots_tail = slot;
+    }
+    sender->status = 0;
+    sender->isBlocked = 0;
+    unblockProc(sender->pid);
+}
+
+// Takes the oldest message of a mailbox for a consumer, shared by MboxRecv
+// and MboxCondRecv. Returns the message size, -1 if it does not fit in
+// maxSize, or -2 if there is no message
+static int takeMessage(Mailbox *mbox, void *msg, int maxSize) {
+    MailSlot *slot = mbox->slots_head;
+    if (slot == NULL) {
+        // A zero-slot mailbox hands messages straight from producer to consumer
+        Phase2Proc *sender = mbox->producerQueue.head;
+        if (sender == NULL) {
+            return -2;
+        }
+        if (sender->msgSize > maxSize) {
+            return -1;
+        }
+        memcpy(msg, sender->msgPtr, sender->msgSize);
+        int size = sender->msgSize;
+        completeProducer(mbox, NULL);
+        return size;
+    }
+    if (slot->messageSize > maxSize) {
+        return -1;
+    }
+
+    // Copy message and update head/tail pointers
+    memcpy(msg, slotMessage(slot), slot->messageSize);
+    int size = slot->messageSize;
+    mbox->slots_head = slot->next;
+    if (mbox->slots_head == NULL) {
+        mbox->slots_tail = NULL;
+    }
+
+    // Reserve the slot for a blocked producer if any, else free it
+    if (mbox->producerQueue.head != NULL) {
+        completeProducer(mbox, slot);
+    } else {
+        freeSlot(slot);
+        mbox->usedSlots--;
+    }
+    return size;
+}
+
 void phase2_init(void) {
     if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
         USLOSS_Console("ERROR: phase2_init called while in user mode\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
-    for (int i = 0; i < MAXPROC; i++) {
+    for (int i = 0; i < KERNEL_MAXPROC; i++) {
         initProc(&P2_ProcTable[i]);
     }
 
-    for (int i = 0; i < MAXMBOX; i++) {
+    for (int i = 0; i < KERNEL_MAXMBOX; i++) {
         mailboxes[i].id = -1;
         mailboxes[i].usedSlots = 0;
         mailboxes[i].isReleased = 0;
@@ -115,25 +396,52 @@ void phase2_init(void) {
         mailboxes[i].producerQueue.tail = NULL;
         mailboxes[i].consumerQueue.head = NULL;
         mailboxes[i].consumerQueue.tail = NULL;
+        mailboxes[i].ownerPid = 0;
+        mailboxes[i].peakSlots = 0;
+        mailboxes[i].flags = 0;
+        mailboxes[i].buffers_head = NULL;
+        mailboxes[i].buffers_tail = NULL;
+        mailboxes[i].anyHead = NULL;
+        mailboxes[i].anyTail = NULL;
     }
     
-    for (int i = 0; i < MAXSLOTS; i++) {
-        mailSlots[i].id = -1;
-        mailSlots[i].next = NULL;
+    freeBufferList = NULL;
+    for (int i = KERNEL_MBOX_BUFFERS - 1; i >= 0; i--) {
+        mboxBuffers[i].inUse = 1;
+        freeBuffer(&mboxBuffers[i]);
     }
+    
+    // Carve the slots and the arena into classes, low slots end up at the
+    // front of each free list
+    int first = 0;
+    char *arena = slotArena;
+    for (int c = 0; c < SLOT_CLASSES; c++) {
+        slotClassFirst[c] = first;
+        slotClassArena[c] = arena;
+        freeSlotLists[c] = NULL;
+        for (int i = first + slotClassCount[c] - 1; i >= first; i--) {
+            mailSlots[i].slotClass = -1;
+            mailSlots[i].next = freeSlotLists[c];
+            freeSlotLists[c] = &mailSlots[i];
+        }
+        first += slotClassCount[c];
+        arena += slotClassCount[c] * slotClassSize[c];
+    }
+    slotsInUse = 0;
+    slotsHighWater = 0;
 
     
     int result = MboxCreate(1, sizeof(int));
     if (result != CLOCK_MB) {
         USLOSS_Console("ERROR: failed to create clock mailbox, got id %d\n", result);
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
     for (int i = 0; i < USLOSS_TERM_UNITS; i++) {
         result = MboxCreate(1, sizeof(int));
         if (result != TERM_MB_BASE + i) {
             USLOSS_Console("ERROR: failed to create terminal mailbox %d, got id %d\n", i, result);
-            USLOSS_Halt(1);
+            haltWithTrace(1);
         }
     }
 
@@ -141,7 +449,7 @@ void phase2_init(void) {
         result = MboxCreate(1, sizeof(int));
         if (result != DISK_MB_BASE + i) {
             USLOSS_Console("ERROR: failed to create disk mailbox %d, got id %d\n", i, result);
-            USLOSS_Halt(1);
+            haltWithTrace(1);
         }
     }
 
@@ -160,18 +468,31 @@ void phase2_init(void) {
 int MboxCreate(int numSlots, int slotSize) {
     if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
         USLOSS_Console("ERROR: MboxCreate called while in user mode\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
+    }
+
+    return MboxCreateFlags(numSlots, slotSize, 0);
+}
+
+int MboxCreateFlags(int numSlots, int slotSize, int flags) {
+    if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
+        USLOSS_Console("ERROR: MboxCreateFlags called while in user mode\n");
+        haltWithTrace(1);
     }
 
-    if (numSlots < 0 || numSlots > MAXSLOTS || slotSize < 0 || slotSize > MAX_MESSAGE) {
+    // zero-copy messages live in kernel buffers, not in slots
+    int maxSize = (flags & MBOX_ZEROCOPY) ? KERNEL_MBOX_BUFFER_SIZE : MAX_MESSAGE;
+    if (numSlots < 0 || numSlots > KERNEL_MAXSLOTS || slotSize < 0 || slotSize > maxSize ||
+        (flags & ~MBOX_ZEROCOPY) != 0) {
         return -1;
     }
 
-    for (int i = 0; i < MAXMBOX; i++) {
+    for (int i = 0; i < KERNEL_MAXMBOX; i++) {
         if (mailboxes[i].id == -1) {
             mailboxes[i].id = i;
             mailboxes[i].numSlots = numSlots;
             mailboxes[i].slotSize = slotSize;
+            mailboxes[i].slotClass = getSlotClass(slotSize);
             mailboxes[i].usedSlots = 0;
             mailboxes[i].isReleased = 0;
             mailboxes[i].slots_head = NULL;
@@ -180,6 +501,13 @@ int MboxCreate(int numSlots, int slotSize) {
             mailboxes[i].producerQueue.tail = NULL;
             mailboxes[i].consumerQueue.head = NULL;
             mailboxes[i].consumerQueue.tail = NULL;
+            mailboxes[i].ownerPid = 0;
+            mailboxes[i].peakSlots = 0;
+            mailboxes[i].flags = flags;
+            mailboxes[i].buffers_head = NULL;
+            mailboxes[i].buffers_tail = NULL;
+            mailboxes[i].anyHead = NULL;
+            mailboxes[i].anyTail = NULL;
             
             return i;
         }
@@ -190,10 +518,10 @@ int MboxCreate(int numSlots, int slotSize) {
 int MboxRelease(int mailboxID) {
     if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
         USLOSS_Console("ERROR: MboxRelease called while in user mode\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
-    if (mailboxID < 0 || mailboxID >= MAXMBOX || 
+    if (mailboxID < 0 || mailboxID >= KERNEL_MAXMBOX || 
         mailboxes[mailboxID].id == -1 || mailboxes[mailboxID].isReleased) {
         return -1;
     }
@@ -210,28 +538,90 @@ int MboxRelease(int mailboxID) {
         proc->status = -3;
         unblockProc(proc->pid);
     }
+    while (mbox->anyHead != NULL) {
+        proc = mbox->anyHead->proc;
+        removeWaits(proc);
+        proc->status = -3;
+        proc->mboxID = mailboxID;
+        unblockProc(proc->pid);
+    }
 
     while (mbox->slots_head != NULL) {
         MailSlot *slot = mbox->slots_head;
         mbox->slots_head = slot->next;
-        slot->id = -1;
-        slot->next = NULL;
+        freeSlot(slot);
     }
     mbox->slots_tail = NULL;
 
+    MboxBuffer *buffer;
+    while ((buffer = dequeueBuffer(mbox)) != NULL) {
+        freeBuffer(buffer);
+    }
+
     mbox->id = -1;
     mbox->usedSlots = 0;
+    mbox->ownerPid = 0;
+    return 0;
+}
+
+int MboxSetOwner(int mailboxID, int pid) {
+    if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
+        USLOSS_Console("ERROR: MboxSetOwner called while in user mode\n");
+        haltWithTrace(1);
+    }
+
+    if (mailboxID < 0 || mailboxID >= KERNEL_MAXMBOX || 
+        mailboxes[mailboxID].id == -1 || mailboxes[mailboxID].isReleased || pid < 0) {
+        return -1;
+    }
+
+    mailboxes[mailboxID].ownerPid = pid;
+    return 0;
+}
+
+void MboxGetSlotStats(int *inUse, int *highWater) {
+    if (inUse != NULL) {
+        *inUse = slotsInUse;
+    }
+    if (highWater != NULL) {
+        *highWater = slotsHighWater;
+    }
+}
+
+int MboxGetStats(int mailboxID, int *used, int *peak) {
+    if (mailboxID < 0 || mailboxID >= KERNEL_MAXMBOX || mailboxes[mailboxID].id == -1) {
+        return -1;
+    }
+    if (used != NULL) {
+        *used = mailboxes[mailboxID].usedSlots;
+    }
+    if (peak != NULL) {
+        *peak = mailboxes[mailboxID].peakSlots;
+    }
     return 0;
 }
 
+// Blocks the caller on a mailbox, lending its priority to the mailbox's
+// owner meanwhile so a busy low priority server cannot stall it
+static void blockOnMbox(Mailbox *mbox) {
+    int owner = mbox->ownerPid;
+    if (owner != 0) {
+        lendPriority(owner);
+    }
+    blockMe();
+    if (owner != 0) {
+        revokePriority(owner);
+    }
+}
+
 int MboxSend(int mailboxID, void *msg, int msgSize) {
     if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
         USLOSS_Console("ERROR: MboxSend called while in user mode\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
-    if (mailboxID < 0 || mailboxID >= MAXMBOX || 
-        mailboxes[mailboxID].id == -1 || msgSize > mailboxes[mailboxID].slotSize) {
+    if (mailboxID < 0 || mailboxID >= KERNEL_MAXMBOX || mailboxes[mailboxID].id == -1 ||
+        (mailboxes[mailboxID].flags & MBOX_ZEROCOPY) || msgSize > mailboxes[mailboxID].slotSize) {
         return -1;
     }
 
@@ -262,49 +652,34 @@ int MboxSend(int mailboxID, void *msg, int msgSize) {
         }
     }
 
+    // Then for a consumer waiting on several mailboxes
+    int delivered = deliverToAny(mbox, msg, msgSize);
+    if (delivered != -2) {
+        return delivered;
+    }
+
     // No waiting consumer, try to queue the message
     if (mbox->usedSlots >= mbox->numSlots) {
         // Mailbox full, must block
         if (mbox->isReleased) return -1;
         proc->isBlocked = 1;
         enqueueProcess(&mbox->producerQueue, proc);
-        blockMe();
+        blockOnMbox(mbox);
         if (mbox->isReleased) return -1;
         return 0;  // Successfully sent after being unblocked
     }
 
-    // Find an empty slot
-    for (int i = 0; i < MAXSLOTS; i++) {
-        if (mailSlots[i].id == -1) {
-            // Initialize the slot
-            mailSlots[i].id = i;
-            memcpy(mailSlots[i].message, msg, msgSize);
-            mailSlots[i].messageSize = msgSize;
-            mailSlots[i].next = NULL;
-
-            // Add to end of queue
-            if (mbox->slots_head == NULL) {
-                mbox->slots_head = &mailSlots[i];
-                mbox->slots_tail = &mailSlots[i];
-            } else {
-                mbox->slots_tail->next = &mailSlots[i];
-                mbox->slots_tail = &mailSlots[i];
-            }
-            mbox->usedSlots++;
-            return 0;
-        }
-    }
-
-    return -2;
+    return queueMessage(mbox, msg, msgSize);
 }
 
 int MboxRecv(int mailboxID, void *msg, int maxSize) {
     if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
         USLOSS_Console("ERROR: MboxRecv called while in user mode\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
-    if (mailboxID < 0 || mailboxID >= MAXMBOX || mailboxes[mailboxID].id == -1) {
+    if (mailboxID < 0 || mailboxID >= KERNEL_MAXMBOX || mailboxes[mailboxID].id == -1 ||
+        (mailboxes[mailboxID].flags & MBOX_ZEROCOPY)) {
         return -1;
     }
 
@@ -320,51 +695,8 @@ int MboxRecv(int mailboxID, void *msg, int maxSize) {
     proc->status = -1;
 
     // Check for queued message first
-    if (mbox->slots_head != NULL) {
-        MailSlot *slot = mbox->slots_head;
-        if (slot->messageSize > maxSize) {
-            return -1;
-        }
-
-        // Copy message and update head/tail pointers
-        memcpy(msg, slot->message, slot->messageSize);
-        int size = slot->messageSize;
-        mbox->slots_head = slot->next;
-        if (mbox->slots_head == NULL) {
-            mbox->slots_tail = NULL;
-        }
-
-        // Free the slot
-        slot->id = -1;
-        slot->next = NULL;
-        mbox->usedSlots--;
-
-        // Wake up a blocked producer if any
-        if (mbox->producerQueue.head != NULL) {
-            Phase2Proc *sender = dequeueProcess(&mbox->producerQueue);
-            // Copy the sender's message to an empty slot
-            for (int i = 0; i < MAXSLOTS; i++) {
-                if (mailSlots[i].id == -1) {
-                    mailSlots[i].id = i;
-                    memcpy(mailSlots[i].message, sender->msgPtr, sender->msgSize);
-                    mailSlots[i].messageSize = sender->msgSize;
-                    mailSlots[i].next = NULL;
-
-                    if (mbox->slots_head == NULL) {
-                        mbox->slots_head = &mailSlots[i];
-                        mbox->slots_tail = &mailSlots[i];
-                    } else {
-                        mbox->slots_tail->next = &mailSlots[i];
-                        mbox->slots_tail = &mailSlots[i];
-                    }
-                    mbox->usedSlots++;
-                    break;
-                }
-            }
-            sender->isBlocked = 0;
-            unblockProc(sender->pid);
-        }
-
+    int size = takeMessage(mbox, msg, maxSize);
+    if (size != -2) {
         return size;
     }
 
@@ -372,7 +704,7 @@ int MboxRecv(int mailboxID, void *msg, int maxSize) {
     if (mbox->isReleased) return -1;
     proc->isBlocked = 1;
     enqueueProcess(&mbox->consumerQueue, proc);
-    blockMe();
+    blockOnMbox(mbox);
     
     if (mbox->isReleased) return -1;
     return proc->status;
@@ -381,11 +713,11 @@ int MboxRecv(int mailboxID, void *msg, int maxSize) {
 int MboxCondSend(int mailboxID, void *msg, int msgSize) {
     if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
         USLOSS_Console("ERROR: MboxCondSend called while in user mode\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
-    if (mailboxID < 0 || mailboxID >= MAXMBOX || 
-        mailboxes[mailboxID].id == -1 || msgSize > mailboxes[mailboxID].slotSize) {
+    if (mailboxID < 0 || mailboxID >= KERNEL_MAXMBOX || mailboxes[mailboxID].id == -1 ||
+        (mailboxes[mailboxID].flags & MBOX_ZEROCOPY) || msgSize > mailboxes[mailboxID].slotSize) {
         return -1;
     }
 
@@ -406,82 +738,244 @@ int MboxCondSend(int mailboxID, void *msg, int msgSize) {
         }
     }
 
+    int delivered = deliverToAny(mbox, msg, msgSize);
+    if (delivered != -2) {
+        return delivered;
+    }
+
     // No waiting consumer, check if mailbox is full
     if (mbox->usedSlots >= mbox->numSlots) {
         return -2;
     }
 
-    // Find empty slot
-    for (int i = 0; i < MAXSLOTS; i++) {
-        if (mailSlots[i].id == -1) {
-            mailSlots[i].id = i;
-            memcpy(mailSlots[i].message, msg, msgSize);
-            mailSlots[i].messageSize = msgSize;
-            mailSlots[i].next = NULL;
-
-            if (mbox->slots_head == NULL) {
-                mbox->slots_head = &mailSlots[i];
-                mbox->slots_tail = &mailSlots[i];
-            } else {
-                mbox->slots_tail->next = &mailSlots[i];
-                mbox->slots_tail = &mailSlots[i];
-            }
-            mbox->usedSlots++;
-            return 0;
-        }
-    }
-    return -2;
+    return queueMessage(mbox, msg, msgSize);
 }
 
 int MboxCondRecv(int mailboxID, void *msg, int maxSize) {
     if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
         USLOSS_Console("ERROR: MboxCondRecv called while in user mode\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
-    if (mailboxID < 0 || mailboxID >= MAXMBOX || mailboxes[mailboxID].id == -1) {
+    if (mailboxID < 0 || mailboxID >= KERNEL_MAXMBOX || mailboxes[mailboxID].id == -1 ||
+        (mailboxes[mailboxID].flags & MBOX_ZEROCOPY)) {
         return -1;
     }
 
     Mailbox *mbox = &mailboxes[mailboxID];
     if (mbox->isReleased) return -1;
 
-    // Check for queued message first
-    if (mbox->slots_head != NULL) {
-        MailSlot *slot = mbox->slots_head;
-        if (slot->messageSize > maxSize) {
+    return takeMessage(mbox, msg, maxSize);
+}
+
+int MboxRecvAny(int mailboxIDs[], int count, void *msg, int maxSize, int *readyID) {
+    if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
+        USLOSS_Console("ERROR: MboxRecvAny called while in user mode\n");
+        haltWithTrace(1);
+    }
+
+    if (mailboxIDs == NULL || readyID == NULL || count < 1 || count > MBOX_RECV_ANY_MAX) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        int id = mailboxIDs[i];
+        if (id < 0 || id >= KERNEL_MAXMBOX || mailboxes[id].id == -1 ||
+            (mailboxes[id].flags & MBOX_ZEROCOPY) || mailboxes[id].isReleased) {
             return -1;
         }
+    }
 
-        memcpy(msg, slot->message, slot->messageSize);
-        int size = slot->messageSize;
+    // Take a message from the first listed mailbox that has one
+    for (int i = 0; i < count; i++) {
+        int size = takeMessage(&mailboxes[mailboxIDs[i]], msg, maxSize);
+        if (size != -2) {
+            *readyID = mailboxIDs[i];
+            return size;
+        }
+    }
 
-        mbox->slots_head = slot->next;
-        if (mbox->slots_head == NULL) {
-            mbox->slots_tail = NULL;
+    // None ready, wait on all of them at once, the first sender removes
+    // every entry before waking us. Any owner may be the one to send, so
+    // all of them get our priority while we wait, as in blockOnMbox
+    WaitEntry entries[MBOX_RECV_ANY_MAX];
+    int owners[MBOX_RECV_ANY_MAX];
+    int ownerCount = 0;
+    Phase2Proc *proc = getProc(getpid());
+    proc->pid = getpid();
+    proc->msgPtr = msg;
+    proc->msgSize = maxSize;
+    proc->mboxID = -1;
+    proc->status = -1;
+    proc->isBlocked = 1;
+    for (int i = 0; i < count; i++) {
+        entries[i].proc = proc;
+        entries[i].mbox = &mailboxes[mailboxIDs[i]];
+        addWait(&entries[i]);
+        if (entries[i].mbox->ownerPid != 0) {
+            owners[ownerCount++] = entries[i].mbox->ownerPid;
         }
+    }
+    proc->waits = entries;
+    proc->waitCount = count;
+    lendPriorityMany(owners, ownerCount);
+    blockMe();
+    revokePriorityMany(owners, ownerCount);
 
-        slot->id = -1;
-        slot->next = NULL;
-        mbox->usedSlots--;
+    proc->isBlocked = 0;
+    *readyID = proc->mboxID;
+    if (proc->status == -3) return -1;
+    return proc->status;
+}
+
+void *MboxBufferAlloc(void) {
+    if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
+        USLOSS_Console("ERROR: MboxBufferAlloc called while in user mode\n");
+        haltWithTrace(1);
+    }
+
+    MboxBuffer *buffer = freeBufferList;
+    if (buffer == NULL) {
+        return NULL;
+    }
+    freeBufferList = buffer->next;
+    buffer->next = NULL;
+    buffer->inUse = 1;
+    buffer->size = 0;
+    return buffer->data;
+}
+
+void MboxBufferRelease(void *data) {
+    if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
+        USLOSS_Console("ERROR: MboxBufferRelease called while in user mode\n");
+        haltWithTrace(1);
+    }
+
+    MboxBuffer *buffer = getBuffer(data);
+    if (buffer == NULL) {
+        USLOSS_Console("ERROR: MboxBufferRelease called with a pointer that is not an allocated buffer\n");
+        haltWithTrace(1);
+    }
+    freeBuffer(buffer);
+}
+
+// Shared by MboxSendBuffer and MboxCondSendBuffer, only blocks if block is set
+static int sendBuffer(int mailboxID, void *data, int size, int block) {
+    if (mailboxID < 0 || mailboxID >= KERNEL_MAXMBOX || mailboxes[mailboxID].id == -1 ||
+        !(mailboxes[mailboxID].flags & MBOX_ZEROCOPY) || size < 0 || size > mailboxes[mailboxID].slotSize) {
+        return -1;
+    }
+
+    Mailbox *mbox = &mailboxes[mailboxID];
+    if (mbox->isReleased) return -1;
+
+    MboxBuffer *buffer = getBuffer(data);
+    if (buffer == NULL) {
+        return -1;
+    }
+    buffer->size = size;
+
+    // Hand the buffer straight to a waiting consumer
+    Phase2Proc *receiver = dequeueProcess(&mbox->consumerQueue);
+    if (receiver != NULL) {
+        *(void **) receiver->msgPtr = buffer->data;
+        receiver->status = size;
+        unblockProc(receiver->pid);
+        return 0;
+    }
+
+    if (mbox->usedSlots < mbox->numSlots) {
+        queueBuffer(mbox, buffer);
+        return 0;
+    }
+    if (!block) {
+        return -2;
+    }
+
+    // Mailbox full, the consumer that frees a slot queues the buffer for us
+    Phase2Proc *proc = getProc(getpid());
+    proc->pid = getpid();
+    proc->msgPtr = buffer;
+    proc->msgSize = size;
+    proc->mboxID = mailboxID;
+    proc->status = -1;
+    proc->isBlocked = 1;
+    enqueueProcess(&mbox->producerQueue, proc);
+    blockOnMbox(mbox);
+    if (mbox->isReleased) return -1;
+    return 0;
+}
+
+int MboxSendBuffer(int mailboxID, void *buffer, int size) {
+    if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
+        USLOSS_Console("ERROR: MboxSendBuffer called while in user mode\n");
+        haltWithTrace(1);
+    }
+
+    return sendBuffer(mailboxID, buffer, size, 1);
+}
+
+int MboxCondSendBuffer(int mailboxID, void *buffer, int size) {
+    if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
+        USLOSS_Console("ERROR: MboxCondSendBuffer called while in user mode\n");
+        haltWithTrace(1);
+    }
+
+    return sendBuffer(mailboxID, buffer, size, 0);
+}
+
+int MboxRecvBuffer(int mailboxID, void **buffer) {
+    if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
+        USLOSS_Console("ERROR: MboxRecvBuffer called while in user mode\n");
+        haltWithTrace(1);
+    }
+
+    if (mailboxID < 0 || mailboxID >= KERNEL_MAXMBOX || mailboxes[mailboxID].id == -1 ||
+        !(mailboxes[mailboxID].flags & MBOX_ZEROCOPY) || buffer == NULL) {
+        return -1;
+    }
+
+    Mailbox *mbox = &mailboxes[mailboxID];
+    if (mbox->isReleased) return -1;
 
-        // Wake up a blocked producer if any
-        Phase2Proc *sender = dequeueProcess(&mbox->producerQueue);
+    MboxBuffer *received = dequeueBuffer(mbox);
+    Phase2Proc *sender = dequeueProcess(&mbox->producerQueue);
+    if (received != NULL) {
+        // Move a blocked producer's buffer into the slot just freed
         if (sender != NULL) {
-            sender->isBlocked = 0;
-            unblockProc(sender->pid);
+            queueBuffer(mbox, sender->msgPtr);
         }
-
-        return size;
+    } else if (sender != NULL) {
+        // Zero-slot mailbox, take the buffer from the producer directly
+        received = sender->msgPtr;
+    }
+    if (sender != NULL) {
+        sender->isBlocked = 0;
+        unblockProc(sender->pid);
     }
+    if (received != NULL) {
+        *buffer = received->data;
+        return received->size;
+    }
+
+    // No message available, must block until a producer hands one over
+    Phase2Proc *proc = getProc(getpid());
+    proc->pid = getpid();
+    proc->msgPtr = buffer;
+    proc->msgSize = 0;
+    proc->mboxID = mailboxID;
+    proc->status = -1;
+    proc->isBlocked = 1;
+    enqueueProcess(&mbox->consumerQueue, proc);
+    blockOnMbox(mbox);
 
-    return -2;  
+    if (mbox->isReleased) return -1;
+    return proc->status;
 }
 
 static void clock_handler(int type, void *arg) {
     if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
         USLOSS_Console("ERROR: clock_handler called while in user mode\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
     int current = currentTime();
@@ -497,31 +991,31 @@ static void clock_handler(int type, void *arg) {
             // Message couldn't be sent - mailbox was full
         } else if (result != 0) {
             USLOSS_Console("ERROR: clock_handler MboxCondSend failed\n");
-            USLOSS_Halt(1);
+            haltWithTrace(1);
         }
     }
 
-    dispatcher();
+    timeSlice();
 }
 
 static void disk_handler(int type, void *arg) {
     if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
         USLOSS_Console("ERROR: disk_handler called while in user mode\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
     int unit = (int)(long)arg;
     
     if (unit < 0 || unit >= USLOSS_DISK_UNITS) {
         USLOSS_Console("ERROR: invalid disk unit %d\n", unit);
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
     int status;
     int rc = USLOSS_DeviceInput(USLOSS_DISK_DEV, unit, &status);
     if (rc != USLOSS_DEV_OK) {
         USLOSS_Console("ERROR: disk_handler DeviceInput failed: %d\n", rc);
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
     int mbox_id = DISK_MB_BASE + unit;
@@ -531,7 +1025,7 @@ static void disk_handler(int type, void *arg) {
         // Message couldn't be sent - mailbox was full
     } else if (result != 0) {
         USLOSS_Console("ERROR: disk_handler MboxCondSend failed\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
     dispatcher();
@@ -540,21 +1034,21 @@ static void disk_handler(int type, void *arg) {
 static void terminal_handler(int type, void *arg) {
     if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
         USLOSS_Console("ERROR: terminal_handler called while in user mode\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
     int unit = (int)(long)arg;
     
     if (unit < 0 || unit >= USLOSS_TERM_UNITS) {
         USLOSS_Console("ERROR: invalid terminal unit %d\n", unit);
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
     int status;
     int rc = USLOSS_DeviceInput(USLOSS_TERM_DEV, unit, &status);
     if (rc != USLOSS_DEV_OK) {
         USLOSS_Console("ERROR: terminal_handler DeviceInput failed: %d\n", rc);
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
     int mbox_id = TERM_MB_BASE + unit;
@@ -564,7 +1058,7 @@ static void terminal_handler(int type, void *arg) {
         // Message couldn't be sent - mailbox was full
     } else if (result != 0) {
         USLOSS_Console("ERROR: terminal_handler MboxCondSend failed\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
     dispatcher();
@@ -573,7 +1067,7 @@ static void terminal_handler(int type, void *arg) {
 static void syscallHandler(int type, void *arg) {
     if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
         USLOSS_Console("ERROR: syscallHandler called while in user mode\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
     
     USLOSS_Sysargs *sysargs = (USLOSS_Sysargs *) arg;
@@ -581,7 +1075,7 @@ static void syscallHandler(int type, void *arg) {
     if (sysargs->number < 0 || sysargs->number >= MAXSYSCALLS) {
         USLOSS_Console("syscallHandler(): Invalid syscall number %d\n", 
                       sysargs->number);
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
     
     systemCallVec[sysargs->number](sysargs);
@@ -592,18 +1086,18 @@ static void syscallHandler(int type, void *arg) {
 static void nullsys(USLOSS_Sysargs *args) {
     USLOSS_Console("nullsys(): Program called an unimplemented syscall.  syscall no: %d   PSR: 0x%02x\n",
                   args->number, USLOSS_PsrGet());
-    USLOSS_Halt(1);
+    haltWithTrace(1);
 }
 
 void waitDevice(int type, int unit, int *status) {
     if ((USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) == 0) {
         USLOSS_Console("ERROR: waitDevice called while in user mode\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
     if (status == NULL) {
         USLOSS_Console("ERROR: waitDevice called with NULL status pointer\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 
     int mbox_id;
@@ -611,7 +1105,7 @@ void waitDevice(int type, int unit, int *status) {
         case USLOSS_CLOCK_DEV:
             if (unit != 0) {
                 USLOSS_Console("ERROR: invalid clock unit %d\n", unit);
-                USLOSS_Halt(1);
+                haltWithTrace(1);
             }
             mbox_id = CLOCK_MB;
             break;
@@ -619,7 +1113,7 @@ void waitDevice(int type, int unit, int *status) {
         case USLOSS_DISK_DEV:
             if (unit < 0 || unit >= USLOSS_DISK_UNITS) {
                 USLOSS_Console("ERROR: invalid disk unit %d\n", unit);
-                USLOSS_Halt(1);
+                haltWithTrace(1);
             }
             mbox_id = DISK_MB_BASE + unit;
             break;
@@ -627,20 +1121,20 @@ void waitDevice(int type, int unit, int *status) {
         case USLOSS_TERM_DEV:
             if (unit < 0 || unit >= USLOSS_TERM_UNITS) {
                 USLOSS_Console("ERROR: invalid terminal unit %d\n", unit);
-                USLOSS_Halt(1);
+                haltWithTrace(1);
             }
             mbox_id = TERM_MB_BASE + unit;
             break;
 
         default:
             USLOSS_Console("ERROR: invalid device type %d\n", type);
-            USLOSS_Halt(1);
+            haltWithTrace(1);
     }
 
     int result = MboxRecv(mbox_id, status, sizeof(int));
     if (result != sizeof(int)) {
         USLOSS_Console("ERROR: waitDevice MboxRecv failed\n");
-        USLOSS_Halt(1);
+        haltWithTrace(1);
     }
 }
 
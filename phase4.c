@@ -8,7 +8,9 @@
  */
 
 #include <phase1.h>
+#include <phase1ext.h>
 #include <phase2.h>
+#include <phase2ext.h>
 #include <phase3.h>
 #include <phase4.h>
 #include <phase4_usermode.h>
@@ -33,7 +35,7 @@ typedef struct SleepRequest {
 };
 
 SleepRequest* sleepRequestQueue; // Queue of sleep requests
-SleepRequest sleepRequestsTable[MAXPROC]; // Table of sleep requests
+SleepRequest sleepRequestsTable[KERNEL_MAXPROC]; // Table of sleep requests
 
 // Sleep request functions
 void sleep(USLOSS_Sysargs *args);
@@ -45,12 +47,13 @@ int termWriteMutex[USLOSS_TERM_UNITS];
 int termToWrite[USLOSS_TERM_UNITS];
 int termReadMbox[USLOSS_TERM_UNITS];
 int termLineIndex[USLOSS_TERM_UNITS];
-char termLines[USLOSS_TERM_UNITS][MAXLINE+1];
+char *termLines[USLOSS_TERM_UNITS]; // line being read, a zero-copy buffer handed to termRead when done
 
 // Terminal request functions
 void termWrite(USLOSS_Sysargs *args);
 void termRead(USLOSS_Sysargs *args);
 int termMain(char *args);
+void sendTermLine(int unit);
 
 // DISK DEVICE
 // arrays to store disk information
@@ -66,7 +69,7 @@ struct DiskRequest {
     int mbox;
     DiskRequest* next;
 };
-DiskRequest diskRequestTable[MAXPROC];
+DiskRequest diskRequestTable[KERNEL_MAXPROC];
 int diskMutex[USLOSS_DISK_UNITS];
 int diskQueueMutex[USLOSS_DISK_UNITS];
 int diskDaemonMutex[USLOSS_DISK_UNITS];
@@ -97,7 +100,7 @@ void phase4_init(void) {
     systemCallVec[SYS_DISKSIZE] = diskSize;
 
     // Initialize sleep request table
-    for (int i = 0; i < MAXPROC; i++) {
+    for (int i = 0; i < KERNEL_MAXPROC; i++) {
         sleepRequestsTable[i].status = FREE;
         sleepRequestsTable[i].next = NULL;
         sleepRequestsTable[i].mbox = -1;
@@ -105,17 +108,17 @@ void phase4_init(void) {
     sleepRequestQueue = NULL;
 
     // Initialize terminal arrays
-    memset(termLines, '\0', sizeof(termLines));
     memset(termLineIndex, 0, sizeof(termLineIndex));
     for (int i = 0; i < USLOSS_TERM_UNITS; i++) {
         USLOSS_DeviceOutput(USLOSS_TERM_DEV, i, (void*)(long)0x2);
-        termReadMbox[i] = MboxCreate(10, MAXLINE);
+        termReadMbox[i] = MboxCreateFlags(10, MAXLINE, MBOX_ZEROCOPY);
+        termLines[i] = MboxBufferAlloc();
         termToWrite[i] = MboxCreate(1, 0);
         termWriteMutex[i] = MboxCreate(1, 0);
     }
 
     // Initialize disk arrays
-    for (int i = 0; i < MAXPROC; i++) {
+    for (int i = 0; i < KERNEL_MAXPROC; i++) {
         diskRequestTable[i].mbox = MboxCreate(1, 0);
         diskRequestTable[i].next = NULL;
         diskRequestTable[i].pid = -1;
@@ -132,30 +135,38 @@ void phase4_init(void) {
 }
 
 /**
- * @brief Starts the deamons for phase 4 by spawning the sleepMain and termMain processes.
+ * @brief Starts the deamons for phase 4 by spawning the sleepMain, termMain and
+ * diskMain processes together with a single sporkMany call.
  */
 void phase4_start_service_processes(void){
+    // the daemons only run after all of them are created, so their
+    // unit arguments must outlive this function
+    static char termUnits[USLOSS_TERM_UNITS][10];
+    static char diskUnits[USLOSS_DISK_UNITS][10];
+    char names[1 + USLOSS_TERM_UNITS + USLOSS_DISK_UNITS][MAXNAME];
+    SporkDesc daemons[1 + USLOSS_TERM_UNITS + USLOSS_DISK_UNITS];
+    int count = 0;
+
     // Start the clock deamon
-    int sleepServicePid = spork("sleepMain", sleepMain, NULL, USLOSS_MIN_STACK, 2);
+    daemons[count++] = (SporkDesc){"sleepMain", sleepMain, NULL, USLOSS_MIN_STACK, 2};
 
     // Start the terminal deamons
     for (int i = 0; i < USLOSS_TERM_UNITS; i++) {
-        char name[128];
-        sprintf(name, "termMain%d", i);
-        char unit[10];
-        sprintf(unit, "%d", i);
-        int termPID = spork(name, termMain, unit, USLOSS_MIN_STACK, 2);
+        sprintf(names[count], "termMain%d", i);
+        sprintf(termUnits[i], "%d", i);
+        daemons[count] = (SporkDesc){names[count], termMain, termUnits[i], USLOSS_MIN_STACK, 2};
+        count++;
     }
 
     // Start the disk deamons
     for (int i = 0; i < USLOSS_DISK_UNITS; i++) {
-        char name[128];
-        sprintf(name, "diskMain%d", i);
-        char unit[10];
-        sprintf(unit, "%d", i);
-
-        int diskPID = spork(name, diskMain, unit, USLOSS_MIN_STACK, 2);
+        sprintf(names[count], "diskMain%d", i);
+        sprintf(diskUnits[i], "%d", i);
+        daemons[count] = (SporkDesc){names[count], diskMain, diskUnits[i], USLOSS_MIN_STACK, 2};
+        count++;
     }
+
+    sporkMany(daemons, count);
 }
 
 /**
@@ -176,7 +187,7 @@ void sleep(USLOSS_Sysargs *args) {
 
     // Find a free slot in the sleep request table
     int sleepIndex = -1;
-    for (int i = 0; i < MAXPROC; i++) {
+    for (int i = 0; i < KERNEL_MAXPROC; i++) {
         if (sleepRequestsTable[i].status == FREE) {
             sleepIndex = i;
             break;
@@ -282,16 +293,21 @@ void termRead(USLOSS_Sysargs *args) {
         return;
     }
 
-    char line[MAXLINE+1];
+    char *line;
 
-    // wait for a line to be read
-    int len = MboxRecv(termReadMbox[unit], &line, MAXLINE+1);
+    // wait for a line to be read, the terminal daemon hands over its buffer
+    int len = MboxRecvBuffer(termReadMbox[unit], (void **) &line);
+    if (len < 0) {
+        args->arg4 = (void *) -1;
+        return;
+    }
 
     if (len > bufferSize) {
         len = bufferSize;
     }
 
     strncpy(buffer, line, len);
+    MboxBufferRelease(line);
 
     args->arg4 = (void *) 0;
     args->arg2 = (void *) len;
@@ -321,33 +337,34 @@ int termMain(char *args) {
             MboxCondSend(termToWrite[unit], NULL, 0);
         } else if (xmit == USLOSS_DEV_ERROR) {
             USLOSS_Console("USLOSS_DEV_ERROR. Halting...\n");
-            USLOSS_Halt(1);
+            haltWithTrace(1);
         }
 
         if (recv == USLOSS_DEV_BUSY) {
             // read the character
             char character = USLOSS_TERM_STAT_CHAR(status);
             
-            if (termLineIndex[unit] < MAXLINE) {
+            if (termLines[unit] == NULL) {
+                termLines[unit] = MboxBufferAlloc();
+            }
+            if (termLines[unit] != NULL && termLineIndex[unit] < MAXLINE) {
                 termLines[unit][termLineIndex[unit]] = character;
                 termLineIndex[unit]++;
             }
             // check if the character is a newline
             if (character == '\n') {
                 // send the line to the mailbox
-                MboxCondSend(termReadMbox[unit], termLines[unit], termLineIndex[unit]);
-                memset(termLines[unit], '\0', sizeof(termLines[unit]));
-                termLineIndex[unit] = 0;
+                sendTermLine(unit);
             }
 
             // check if the line is full, if so add character to new line after sending the current line
             if (termLineIndex[unit] == MAXLINE) {
-                MboxCondSend(termReadMbox[unit], termLines[unit], termLineIndex[unit]);
-                memset(termLines[unit], '\0', sizeof(termLines[unit]));
-                termLineIndex[unit] = 0;
+                sendTermLine(unit);
 
-                termLines[unit][termLineIndex[unit]] = character;
-                termLineIndex[unit]++;
+                if (termLines[unit] != NULL) {
+                    termLines[unit][termLineIndex[unit]] = character;
+                    termLineIndex[unit]++;
+                }
             }
 
 
@@ -355,7 +372,7 @@ int termMain(char *args) {
 
         } else if (recv == USLOSS_DEV_ERROR) {
             USLOSS_Console("An error occurred on unit %d\n", unit);
-            USLOSS_Halt(1);
+            haltWithTrace(1);
         }
 
     }
@@ -363,6 +380,21 @@ int termMain(char *args) {
     return 0;
 }
 
+/**
+ * @brief Hands the line read so far on a terminal to the read mailbox and
+ *        starts a new one. The line is dropped if the mailbox is full, and its
+ *        buffer is reused.
+ * 
+ * @param unit: The terminal unit number.
+ */
+void sendTermLine(int unit) {
+    if (termLines[unit] != NULL &&
+        MboxCondSendBuffer(termReadMbox[unit], termLines[unit], termLineIndex[unit]) == 0) {
+        termLines[unit] = MboxBufferAlloc();
+    }
+    termLineIndex[unit] = 0;
+}
+
 /**
  * @brief System call for reading from the disk.
  * 
@@ -385,13 +417,13 @@ void diskRead(USLOSS_Sysargs *args) {
     //acquire the mutex for the queue
     MboxSend(diskQueueMutex[unit], NULL, 0);
 
-    diskRequestTable[pid % MAXPROC].pid = pid;
-    diskRequestTable[pid % MAXPROC].track = trackStart;
-    diskRequestTable[pid % MAXPROC].block = blockStart;
-    diskRequestTable[pid % MAXPROC].sectors = sectorNumber;
-    diskRequestTable[pid % MAXPROC].unit = unit;
-    diskRequestTable[pid % MAXPROC].buffer = buffer;
-    diskRequestTable[pid % MAXPROC].operation = USLOSS_DISK_READ;
+    diskRequestTable[pid % KERNEL_MAXPROC].pid = pid;
+    diskRequestTable[pid % KERNEL_MAXPROC].track = trackStart;
+    diskRequestTable[pid % KERNEL_MAXPROC].block = blockStart;
+    diskRequestTable[pid % KERNEL_MAXPROC].sectors = sectorNumber;
+    diskRequestTable[pid % KERNEL_MAXPROC].unit = unit;
+    diskRequestTable[pid % KERNEL_MAXPROC].buffer = buffer;
+    diskRequestTable[pid % KERNEL_MAXPROC].operation = USLOSS_DISK_READ;
 
     addToDiskQueue(unit, pid);
 
@@ -399,7 +431,7 @@ void diskRead(USLOSS_Sysargs *args) {
     MboxRecv(diskQueueMutex[unit], NULL, 0);
 
     MboxCondSend(diskMutex[unit], NULL, 0);
-    MboxRecv(diskRequestTable[pid % MAXPROC].mbox, NULL, 0);
+    MboxRecv(diskRequestTable[pid % KERNEL_MAXPROC].mbox, NULL, 0);
 
     args->arg1 = (void *)(long) 0;
     args->arg4 = (void *)(long) 0;
@@ -431,20 +463,20 @@ void diskWrite(USLOSS_Sysargs *args) {
     MboxSend(diskQueueMutex[unit], NULL, 0);
 
     // add it to the request table
-    diskRequestTable[pid % MAXPROC].pid = pid;
-    diskRequestTable[pid % MAXPROC].track = trackStart;
-    diskRequestTable[pid % MAXPROC].block = blockStart;
-    diskRequestTable[pid % MAXPROC].sectors = sectorNumber;
-    diskRequestTable[pid % MAXPROC].unit = unit;
-    diskRequestTable[pid % MAXPROC].buffer = buffer;
-    diskRequestTable[pid % MAXPROC].operation = USLOSS_DISK_WRITE;
+    diskRequestTable[pid % KERNEL_MAXPROC].pid = pid;
+    diskRequestTable[pid % KERNEL_MAXPROC].track = trackStart;
+    diskRequestTable[pid % KERNEL_MAXPROC].block = blockStart;
+    diskRequestTable[pid % KERNEL_MAXPROC].sectors = sectorNumber;
+    diskRequestTable[pid % KERNEL_MAXPROC].unit = unit;
+    diskRequestTable[pid % KERNEL_MAXPROC].buffer = buffer;
+    diskRequestTable[pid % KERNEL_MAXPROC].operation = USLOSS_DISK_WRITE;
 
     addToDiskQueue(unit, pid);
 
     MboxRecv(diskQueueMutex[unit], NULL, 0);
 
     MboxCondSend(diskMutex[unit], NULL, 0);
-    MboxRecv(diskRequestTable[pid % MAXPROC].mbox, NULL, 0);
+    MboxRecv(diskRequestTable[pid % KERNEL_MAXPROC].mbox, NULL, 0);
     args->arg1 = (void *)(long) 0;
     args->arg4 = (void *)(long) 0;
 
@@ -573,32 +605,32 @@ void addToDiskQueue(int unit, int pid){
 
     // if the queue is empty, the request is the head
     if (diskQueue[unit] == NULL) {
-        diskQueue[unit] = &diskRequestTable[pid % MAXPROC];
+        diskQueue[unit] = &diskRequestTable[pid % KERNEL_MAXPROC];
         return;
     }
     request = diskQueue[unit];
     int currTrack = request->track;
-    int tableTrack = diskRequestTable[pid % MAXPROC].track;
+    int tableTrack = diskRequestTable[pid % KERNEL_MAXPROC].track;
 
     if (currTrack <= tableTrack) {
         while (request->next != NULL && tableTrack >= request->next->track && request->next->track >= currTrack) {
             request = request->next;
         }
-        diskRequestTable[pid % MAXPROC].next = request->next;
-        request->next = &diskRequestTable[pid % MAXPROC];
+        diskRequestTable[pid % KERNEL_MAXPROC].next = request->next;
+        request->next = &diskRequestTable[pid % KERNEL_MAXPROC];
     } else {
         while (request->next != NULL && currTrack <= request->next->track) {
             request = request->next;
         }
 
         if (request->next == NULL) {
-            request->next = &diskRequestTable[pid % MAXPROC];
+            request->next = &diskRequestTable[pid % KERNEL_MAXPROC];
         } else {
             while (request->next != NULL && tableTrack >= request->next->track) {
                 request = request->next;
             }
-            diskRequestTable[pid % MAXPROC].next = request->next;
-            request->next = &diskRequestTable[pid % MAXPROC];
+            diskRequestTable[pid % KERNEL_MAXPROC].next = request->next;
+            request->next = &diskRequestTable[pid % KERNEL_MAXPROC];
         }
     }
 
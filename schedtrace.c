@@ -0,0 +1,290 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: schedtrace.c
+ * Description: Host-side decoder for the scheduler trace written by
+ *              phase1b-new.c. Prints one timeline per process, with the
+ *              start and end of each interval it was runnable, running or
+ *              blocked, and a histogram of the time processes spent runnable
+ *              before they got the CPU.
+ *              Build with: gcc -o schedtrace schedtrace.c
+ *              Usage: ./schedtrace [trace file]
+ */
+
+#include "schedtrace.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_PIDS 4096 // pids tracked at once, larger pids are folded
+#define BUCKETS 24 // power of two latency buckets, the last one is open ended
+
+// process states in the timeline
+#define STATE_NONE 0 // not seen yet, or joined
+#define STATE_RUNNABLE 1
+#define STATE_RUNNING 2
+#define STATE_BLOCKED 3 // arg is the block status
+#define STATE_QUIT 4 // waiting to be joined, arg is the exit status
+#define STATE_JOINED 5 // a point, not an interval, arg is the parent
+
+/**
+ * Struct to represent one interval of a process timeline.
+ */
+typedef struct Interval {
+    int pid;
+    int state; // one of the STATE_ values
+    int arg; // the state detail
+    int start;
+    int end; // -1 if the state lasted until the end of the trace
+    int seq; // order the interval was closed in, keeps each timeline in time order
+} Interval;
+
+int statePid[MAX_PIDS]; // pid whose state is kept in the slot
+int state[MAX_PIDS];
+int stateArg[MAX_PIDS];
+int stateSince[MAX_PIDS]; // time the pid entered its state
+Interval* intervals;
+int intervalCount;
+int histogram[BUCKETS];
+long long totalLatency;
+int latencyCount;
+int maxLatency;
+
+/**
+ * This helper function appends an interval to the timeline.
+ *
+ * @param pid - the process
+ * @param kind - the state it was in
+ * @param arg - the state detail
+ * @param start - when it entered the state
+ * @param end - when it left the state, -1 for the end of the trace
+ */
+void addInterval(int pid, int kind, int arg, int start, int end){
+    Interval* interval = &intervals[intervalCount];
+    interval->pid = pid;
+    interval->state = kind;
+    interval->arg = arg;
+    interval->start = start;
+    interval->end = end;
+    interval->seq = intervalCount;
+    intervalCount++;
+}
+
+/**
+ * This helper function adds the wait of a process that just got the CPU to
+ * the latency histogram.
+ *
+ * @param latency - how long it was runnable, in microseconds
+ */
+void addLatency(int latency){
+    int bucket = 0;
+    while (bucket < BUCKETS - 1 && (1 << bucket) <= latency) {
+        bucket++;
+    }
+    histogram[bucket]++;
+    totalLatency += latency;
+    latencyCount++;
+    if (latency > maxLatency) {
+        maxLatency = latency;
+    }
+}
+
+/**
+ * This helper function moves a process to a new state, closing the interval
+ * of the state it leaves. A process switched in after waiting runnable adds
+ * its wait to the latency histogram.
+ *
+ * @param pid - the process
+ * @param kind - the new state
+ * @param arg - the new state detail
+ * @param time - when the process changed state
+ */
+void setState(int pid, int kind, int arg, int time){
+    int slot = pid % MAX_PIDS;
+    if (statePid[slot] != pid) {
+        statePid[slot] = pid;
+        state[slot] = STATE_NONE;
+    }
+    if (state[slot] != STATE_NONE) {
+        addInterval(pid, state[slot], stateArg[slot], stateSince[slot], time);
+    }
+    if (state[slot] == STATE_RUNNABLE && kind == STATE_RUNNING) {
+        addLatency(time - stateSince[slot]);
+    }
+    state[slot] = kind;
+    stateArg[slot] = arg;
+    stateSince[slot] = time;
+}
+
+/**
+ * This helper function returns the state a process is in.
+ *
+ * @param pid - the process
+ *
+ * @return one of the STATE_ values
+ */
+int getState(int pid){
+    int slot = pid % MAX_PIDS;
+    return statePid[slot] == pid ? state[slot] : STATE_NONE;
+}
+
+/**
+ * This helper function applies one trace record to the timelines.
+ *
+ * @param record - the record
+ */
+void applyRecord(TraceRecord* record){
+    int pid = record->pid;
+    int arg = record->arg;
+    if (pid <= 0) {
+        return;
+    }
+    switch (record->event) {
+        case TRACE_SPORK:
+        case TRACE_UNBLOCK:
+            setState(pid, STATE_RUNNABLE, 0, record->time);
+            break;
+        case TRACE_SWITCH:
+            // the old process was preempted unless it blocked or quit first
+            if (getState(pid) != STATE_BLOCKED && getState(pid) != STATE_QUIT) {
+                setState(pid, STATE_RUNNABLE, 0, record->time);
+            }
+            if (arg > 0) {
+                setState(arg, STATE_RUNNING, 0, record->time);
+            }
+            break;
+        case TRACE_BLOCK:
+            setState(pid, STATE_BLOCKED, arg, record->time);
+            break;
+        case TRACE_QUIT:
+            setState(pid, STATE_QUIT, arg, record->time);
+            break;
+        case TRACE_JOIN:
+            if (arg > 0) {
+                setState(arg, STATE_NONE, 0, record->time);
+                addInterval(arg, STATE_JOINED, pid, record->time, record->time);
+            }
+            break;
+    }
+}
+
+/**
+ * This helper function orders intervals by pid, and each pid's in time order.
+ *
+ * @param a - the first interval
+ * @param b - the second interval
+ *
+ * @return negative, zero or positive, as qsort expects
+ */
+int compareIntervals(const void* a, const void* b){
+    const Interval* x = a;
+    const Interval* y = b;
+    if (x->pid != y->pid) {
+        return x->pid < y->pid ? -1 : 1;
+    }
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+/**
+ * This helper function prints one timeline section for each process, with
+ * the start and end time of every interval it spent runnable, running,
+ * blocked or waiting to be joined.
+ */
+void printTimelines(void){
+    qsort(intervals, intervalCount, sizeof(Interval), compareIntervals);
+    for (int i = 0; i < intervalCount; i++) {
+        Interval* interval = &intervals[i];
+        if (i == 0 || interval->pid != intervals[i - 1].pid) {
+            printf("%spid %d\n", i == 0 ? "" : "\n", interval->pid);
+        }
+        char label[32];
+        switch (interval->state) {
+            case STATE_RUNNABLE:
+                snprintf(label, sizeof(label), "RUNNABLE");
+                break;
+            case STATE_RUNNING:
+                snprintf(label, sizeof(label), "RUNNING");
+                break;
+            case STATE_BLOCKED:
+                snprintf(label, sizeof(label), "BLOCKED %d", interval->arg);
+                break;
+            case STATE_QUIT:
+                snprintf(label, sizeof(label), "QUIT %d", interval->arg);
+                break;
+            default:
+                printf("  %-12s %10d  by pid %d\n", "JOINED", interval->start, interval->arg);
+                continue;
+        }
+        if (interval->end < 0) {
+            printf("  %-12s %10d - %10s\n", label, interval->start, "end");
+        } else {
+            printf("  %-12s %10d - %10d  %8d us\n", label, interval->start, interval->end,
+                interval->end - interval->start);
+        }
+    }
+}
+
+/**
+ * This helper function prints the wait latency histogram.
+ */
+void printHistogram(void){
+    printf("\nWait latency (runnable to running), %d samples", latencyCount);
+    if (latencyCount == 0) {
+        printf("\n");
+        return;
+    }
+    printf(", mean %lld us, max %d us\n", totalLatency / latencyCount, maxLatency);
+    for (int i = 0; i < BUCKETS; i++) {
+        if (histogram[i] == 0) {
+            continue;
+        }
+        int low = i == 0 ? 0 : 1 << (i - 1);
+        if (i == BUCKETS - 1) {
+            printf("  >= %8d us: %d\n", low, histogram[i]);
+        } else {
+            printf("  < %9d us: %d\n", 1 << i, histogram[i]);
+        }
+    }
+}
+
+int main(int argc, char* argv[]){
+    const char* path = argc > 1 ? argv[1] : TRACE_FILE;
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "ERROR: cannot open %s\n", path);
+        return 1;
+    }
+    int header[2];
+    if (fread(header, sizeof(int), 2, file) != 2 || header[0] != TRACE_MAGIC || header[1] < 0) {
+        fprintf(stderr, "ERROR: %s is not a scheduler trace\n", path);
+        fclose(file);
+        return 1;
+    }
+    // a record closes at most two intervals and a join adds one, and every
+    // pid may still have one open at the end
+    intervals = malloc((3 * (size_t)header[1] + MAX_PIDS) * sizeof(Interval));
+    if (intervals == NULL) {
+        fprintf(stderr, "ERROR: trace of %d records is too large\n", header[1]);
+        fclose(file);
+        return 1;
+    }
+
+    TraceRecord record;
+    int count = 0;
+    while (count < header[1] && fread(&record, sizeof(TraceRecord), 1, file) == 1) {
+        applyRecord(&record);
+        count++;
+    }
+    fclose(file);
+    if (count < header[1]) {
+        fprintf(stderr, "warning: trace truncated, read %d of %d records\n", count, header[1]);
+    }
+    for (int i = 0; i < MAX_PIDS; i++) {
+        if (state[i] != STATE_NONE) {
+            addInterval(statePid[i], state[i], stateArg[i], stateSince[i], -1);
+        }
+    }
+    printTimelines();
+    printHistogram();
+    free(intervals);
+    return 0;
+}
@@ -0,0 +1,37 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: schedtrace.h
+ * Description: Binary format of the scheduler trace that phase1b-new.c records
+ *              and schedtrace.c decodes. Does not depend on USLOSS.
+ */
+
+#ifndef SCHEDTRACE_H
+#define SCHEDTRACE_H
+
+#define TRACE_FILE "sched.trace" // written when the simulator halts
+#define TRACE_MAGIC 0x43525453 // "STRC", first word of a trace file
+#define TRACE_SIZE 4096 // records kept in the ring buffer, must be a power of two
+
+// trace events
+#define TRACE_SWITCH 0 // pid was switched out for arg
+#define TRACE_BLOCK 1 // pid blocked, arg is its new process state
+#define TRACE_UNBLOCK 2 // pid became runnable, arg is the state it left
+#define TRACE_SPORK 3 // pid was created by arg
+#define TRACE_QUIT 4 // pid quit with exit status arg
+#define TRACE_JOIN 5 // pid joined its child arg
+
+/**
+ * Struct to represent one trace record.
+ * 
+ * A trace file is the TRACE_MAGIC word, the record count, and then the
+ * records oldest first.
+ */
+typedef struct TraceRecord {
+    int time; // simulated time in microseconds
+    int event; // one of the TRACE_ events
+    int pid;
+    int arg;
+} TraceRecord;
+
+#endif
@@ -0,0 +1,48 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: tests/bench_dispatch.c
+ * Description: Measures the cost of a full dispatcher pass as the number of
+ *              runnable processes grows toward the process table size. The
+ *              ready bitmap should keep the cost flat.
+ *              Build with: gcc -O2 -Itests -I. -o bench_dispatch tests/bench_dispatch.c tests/hostusloss.c phase1b-new.c
+ *              Usage: ./bench_dispatch
+ */
+
+#include "phase1.h"
+#include "phase1ext.h"
+#include "usloss.h"
+#include "hostusloss.h"
+#include <stdio.h>
+
+#define PASSES 1000000 // dispatcher passes timed per process count
+
+extern int needResched; // phase1b-new.c, set to force a full pass
+
+int idle(char *arg){
+    return 0;
+}
+
+int testcase_main(char *arg){
+    int counts[] = {0, 1, 12, 24, 36, KERNEL_MAXPROC - 2};
+    int runnable = 0;
+    USLOSS_Console("runnable  ns/dispatch\n");
+    for (int i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        // the children stay runnable below testcase_main, spread over two priorities
+        while (runnable < counts[i]) {
+            CHECK(spork("idle", idle, NULL, USLOSS_MIN_STACK, 4 + runnable % 2) > 0, "spork failed");
+            runnable++;
+        }
+        long long start = hostNanos();
+        for (int j = 0; j < PASSES; j++) {
+            needResched = 1;
+            dispatcher();
+        }
+        long long elapsed = hostNanos() - start;
+        USLOSS_Console("%8d  %11.1f\n", runnable, (double)elapsed / PASSES);
+    }
+    int status;
+    while (join(&status) > 0) {
+    }
+    return hostReport("bench_dispatch");
+}
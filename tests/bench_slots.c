@@ -0,0 +1,60 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: tests/bench_slots.c
+ * Description: Measures mailbox send/recv throughput with 10%, 50% and 95% of
+ *              the KERNEL_MAXSLOTS mail slots already holding messages. The
+ *              slots are filled through one filler mailbox, and each pair
+ *              timed is an MboxCondSend and an MboxCondRecv on a second one.
+ *              Build with: gcc -O2 -Itests -I. -o bench_slots tests/bench_slots.c tests/hostusloss.c tests/phase2host.c phase1b-new.c
+ *              Usage: ./bench_slots
+ */
+
+#include "phase1.h"
+#include "phase1ext.h"
+#include "phase2.h"
+#include "usloss.h"
+#include "hostusloss.h"
+#include <stdio.h>
+
+#define PAIRS 200000 // send/recv pairs timed at each occupancy
+#define MESSAGE_SIZE 8
+
+/**
+ * This helper function fills a share of the mail slots and times send/recv
+ * pairs through another mailbox while they stay full.
+ *
+ * @param percent - the share of KERNEL_MAXSLOTS to fill, in percent
+ */
+void runOccupancy(int percent){
+    int filled = KERNEL_MAXSLOTS * percent / 100;
+    char message[MESSAGE_SIZE] = {0};
+    int filler = MboxCreate(filled, MESSAGE_SIZE);
+    CHECK(filler >= 0, "could not create a filler mailbox of %d slots", filled);
+    for (int i = 0; i < filled; i++) {
+        CHECK(MboxCondSend(filler, message, MESSAGE_SIZE) == 0, "filler send %d of %d failed", i + 1, filled);
+    }
+    int mailbox = MboxCreate(1, MESSAGE_SIZE);
+    CHECK(mailbox >= 0, "MboxCreate failed");
+
+    long long start = hostNanos();
+    for (int i = 0; i < PAIRS; i++) {
+        MboxCondSend(mailbox, message, MESSAGE_SIZE);
+        MboxCondRecv(mailbox, message, MESSAGE_SIZE);
+    }
+    long long elapsed = hostNanos() - start;
+    CHECK(MboxCondRecv(mailbox, message, MESSAGE_SIZE) == -2, "a message was left over");
+
+    CHECK(MboxRelease(mailbox) == 0, "MboxRelease failed");
+    CHECK(MboxRelease(filler) == 0, "MboxRelease of the filler failed");
+    USLOSS_Console("%8d%% %10d %12.1f\n", percent, filled, (double)elapsed / PAIRS);
+}
+
+int testcase_main(char *arg){
+    phase2_init();
+    USLOSS_Console("%9s %10s %12s\n", "occupancy", "slots used", "ns/pair");
+    runOccupancy(10);
+    runOccupancy(50);
+    runOccupancy(95);
+    return hostReport("bench_slots");
+}
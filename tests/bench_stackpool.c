@@ -0,0 +1,59 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: tests/bench_stackpool.c
+ * Description: Measures spork/join throughput with pooled stacks against the
+ *              malloc path. Stacks larger than the biggest pool class are
+ *              malloc'd and freed for every process, so a size one byte over
+ *              that class times the malloc path at almost the same size.
+ *              Build with: gcc -O2 -Itests -I. -o bench_stackpool tests/bench_stackpool.c tests/hostusloss.c phase1b-new.c
+ *              Usage: ./bench_stackpool
+ */
+
+#include "phase1.h"
+#include "phase1ext.h"
+#include "usloss.h"
+#include "hostusloss.h"
+#include <stdio.h>
+
+#define CYCLES 100000 // spork/join cycles timed per stack size
+
+int child(char *arg){
+    return 0;
+}
+
+/**
+ * This helper function sporks and joins children with the given stack size
+ * and prints how long each cycle took and where the stacks came from.
+ *
+ * @param label - what the stack size exercises
+ * @param stackSize - the stack size of every child
+ */
+void runCycles(char *label, int stackSize){
+    int hits, misses, highWater;
+    getStackPoolStats(&hits, &misses, &highWater);
+    int startHits = hits;
+    int startMisses = misses;
+    int status;
+
+    long long start = hostNanos();
+    for (int i = 0; i < CYCLES; i++) {
+        // the child has a better priority, so it runs and quits inside spork
+        int pid = spork("child", child, NULL, stackSize, 2);
+        CHECK(pid > 0, "spork failed");
+        CHECK(join(&status) == pid, "join returned the wrong child");
+    }
+    long long elapsed = hostNanos() - start;
+
+    getStackPoolStats(&hits, &misses, &highWater);
+    USLOSS_Console("%-14s %8d  %10.0f  %6d  %6d\n", label, stackSize, (double)elapsed / CYCLES,
+        hits - startHits, misses - startMisses);
+}
+
+int testcase_main(char *arg){
+    USLOSS_Console("%-14s %8s  %10s  %6s  %6s\n", "path", "stack", "ns/cycle", "hits", "misses");
+    runCycles("pool", USLOSS_MIN_STACK);
+    runCycles("pool", 8 * USLOSS_MIN_STACK);
+    runCycles("malloc", 8 * USLOSS_MIN_STACK + 1);
+    return hostReport("bench_stackpool");
+}
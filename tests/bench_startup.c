@@ -0,0 +1,78 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: tests/bench_startup.c
+ * Description: Measures starting the phase 4 service daemons one spork at a
+ *              time against a single sporkMany call. The daemons are the
+ *              same seven phase4_start_service_processes starts, at the same
+ *              priority, and each blocks at once as if waiting for its device.
+ *              Build with: gcc -O2 -Itests -I. -o bench_startup tests/bench_startup.c tests/hostusloss.c phase1b-new.c
+ *              Usage: ./bench_startup
+ */
+
+#include "phase1.h"
+#include "phase1ext.h"
+#include "usloss.h"
+#include "hostusloss.h"
+#include <stdio.h>
+
+#define DAEMONS (1 + USLOSS_TERM_UNITS + USLOSS_DISK_UNITS) // sleep, terminal and disk daemons
+#define STARTUPS 10000 // startups timed per method
+#define DAEMON_BLOCK_STATUS 20
+
+int daemonMain(char *arg){
+    blockMe(DAEMON_BLOCK_STATUS);
+    return 0;
+}
+
+/**
+ * This helper function starts the daemons over and over, and prints how long
+ * a startup took and how many dispatcher passes it needed. Stopping them
+ * again is not timed.
+ *
+ * @param label - the method, for the output
+ * @param batched - 1 to start them with sporkMany, 0 with a spork each
+ */
+void runStartups(char *label, int batched){
+    SporkDesc daemons[DAEMONS];
+    long long elapsed = 0;
+    int dispatches, avoided;
+    getDispatchStats(&dispatches, &avoided);
+    int passes = 0;
+
+    for (int i = 0; i < STARTUPS; i++) {
+        for (int j = 0; j < DAEMONS; j++) {
+            daemons[j] = (SporkDesc){"daemon", daemonMain, NULL, USLOSS_MIN_STACK, 2, 0};
+        }
+        int before = dispatches;
+        long long start = hostNanos();
+        if (batched) {
+            CHECK(sporkMany(daemons, DAEMONS) == DAEMONS, "sporkMany failed");
+        } else {
+            for (int j = 0; j < DAEMONS; j++) {
+                daemons[j].pid = spork(daemons[j].name, daemons[j].startFunc, daemons[j].arg,
+                    daemons[j].stackSize, daemons[j].priority);
+            }
+        }
+        elapsed += hostNanos() - start;
+        getDispatchStats(&dispatches, &avoided);
+        passes += dispatches - before;
+
+        int status;
+        for (int j = 0; j < DAEMONS; j++) {
+            CHECK(unblockProc(daemons[j].pid) == 0, "daemon %d was not blocked", daemons[j].pid);
+        }
+        for (int j = 0; j < DAEMONS; j++) {
+            CHECK(join(&status) > 0, "join failed");
+        }
+        getDispatchStats(&dispatches, &avoided);
+    }
+    USLOSS_Console("%-9s %10.0f  %14.1f\n", label, (double)elapsed / STARTUPS, (double)passes / STARTUPS);
+}
+
+int testcase_main(char *arg){
+    USLOSS_Console("%-9s %10s  %14s\n", "method", "ns/startup", "passes/startup");
+    runStartups("spork", 0);
+    runStartups("sporkMany", 1);
+    return hostReport("bench_startup");
+}
@@ -0,0 +1,199 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: tests/hostusloss.c
+ * Description: Runs the kernel on the host instead of in USLOSS. Contexts are
+ *              ucontexts, the PSR is a variable, and the clock device reads
+ *              a simulated time that only hostWork advances, delivering a
+ *              clock interrupt every HOST_CLOCK_PERIOD microseconds of work.
+ *              Linked into every test and benchmark in this directory.
+ */
+
+#include "phase1.h"
+#include "phase1ext.h"
+#include "phase1helper.h"
+#include "usloss.h"
+#include "hostusloss.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct StartInfo StartInfo;
+
+/**
+ * Struct to represent what a process runs when it is first switched to.
+ */
+struct StartInfo{
+    int (*startFunc)(char*);
+    char *arg;
+};
+
+void (*USLOSS_IntVec[USLOSS_NUM_INTS])(int dev, void *arg);
+unsigned int hostPsr;
+int hostTime; // simulated time in microseconds
+StartInfo startInfo[KERNEL_MAXPROC]; // indexed like the process table
+int hostFailures;
+
+unsigned int USLOSS_PsrGet(void){
+    return hostPsr;
+}
+
+int USLOSS_PsrSet(unsigned int psr){
+    hostPsr = psr;
+    return USLOSS_DEV_OK;
+}
+
+void USLOSS_Console(char *format, ...){
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void USLOSS_Halt(int status){
+    fflush(stdout);
+    // like USLOSS, an error halt ends the run without the atexit handlers
+    if (status != 0) {
+        _exit(status);
+    }
+    exit(status);
+}
+
+void USLOSS_ContextInit(USLOSS_Context *context, void *stack, int stackSize, void *pageTable, void (*func)(void)){
+    getcontext(&context->context);
+    context->context.uc_stack.ss_sp = stack;
+    context->context.uc_stack.ss_size = stackSize;
+    context->context.uc_link = NULL;
+    makecontext(&context->context, func, 0);
+}
+
+void USLOSS_ContextSwitch(USLOSS_Context *old, USLOSS_Context *new){
+    if (old == NULL) {
+        setcontext(&new->context);
+    }
+    swapcontext(&old->context, &new->context);
+}
+
+int USLOSS_DeviceInput(int dev, int unit, int *status){
+    if (dev != USLOSS_CLOCK_DEV || unit != 0) {
+        return USLOSS_DEV_INVALID;
+    }
+    *status = hostTime;
+    return USLOSS_DEV_OK;
+}
+
+/**
+ * This helper function runs the start function of the current process with
+ * interrupts enabled, and quits with its return value.
+ */
+void launch(void){
+    StartInfo *start = &startInfo[getpid() % KERNEL_MAXPROC];
+    USLOSS_PsrSet(USLOSS_PSR_CURRENT_MODE | USLOSS_PSR_CURRENT_INT);
+    quit(start->startFunc(start->arg));
+    USLOSS_Console("ERROR: quit() returned to pid %d.\n", getpid());
+    USLOSS_Halt(1);
+}
+
+void russ_ContextInit(int pid, USLOSS_Context *context, void *stack, int stackSize, int (*startFunc)(char*), char *arg){
+    startInfo[pid % KERNEL_MAXPROC].startFunc = startFunc;
+    startInfo[pid % KERNEL_MAXPROC].arg = arg;
+    USLOSS_ContextInit(context, stack, stackSize, NULL, launch);
+}
+
+/**
+ * This helper function delivers an interrupt the way USLOSS does, in kernel
+ * mode with interrupts disabled. Nothing is delivered while interrupts are off.
+ *
+ * @param interrupt - the interrupt number
+ * @param dev - the device passed to the handler
+ */
+void deliverInterrupt(int interrupt, int dev){
+    unsigned int psr = hostPsr;
+    if ((psr & USLOSS_PSR_CURRENT_INT) == 0 || USLOSS_IntVec[interrupt] == NULL) {
+        return;
+    }
+    hostPsr = USLOSS_PSR_CURRENT_MODE;
+    USLOSS_IntVec[interrupt](dev, NULL);
+    hostPsr = psr;
+}
+
+/**
+ * This function makes the current process use the CPU for the given amount of
+ * simulated time. A clock interrupt is delivered at each clock period on the
+ * way, which may switch to another process before the work is done.
+ *
+ * @param usec - the CPU time to use, in microseconds
+ */
+void hostWork(int usec){
+    int left = usec;
+    while (left > 0) {
+        int step = HOST_CLOCK_PERIOD - hostTime % HOST_CLOCK_PERIOD;
+        if (step > left) {
+            hostTime += left;
+            return;
+        }
+        hostTime += step;
+        left -= step;
+        deliverInterrupt(USLOSS_CLOCK_INT, USLOSS_CLOCK_DEV);
+    }
+}
+
+/**
+ * This function returns a host clock reading for benchmarks.
+ *
+ * @return monotonic host time in nanoseconds
+ */
+long long hostNanos(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * This function prints the result of a test.
+ *
+ * @param name - the name of the test
+ *
+ * @return the exit status for testcase_main, 0 if every check passed
+ */
+int hostReport(char *name){
+    if (hostFailures > 0) {
+        USLOSS_Console("%s: FAILED %d checks\n", name, hostFailures);
+        return 1;
+    }
+    USLOSS_Console("%s: PASSED\n", name);
+    return 0;
+}
+
+/**
+ * This helper function is the clock interrupt handler until phase 2 installs its own.
+ */
+void hostClockHandler(int dev, void *arg){
+    timeSlice();
+}
+
+int init_main(char *arg){
+    int status = 0;
+    int result = 1;
+    int pid = spork("testcase_main", testcase_main, NULL, USLOSS_MIN_STACK, 3);
+    while (join(&status) > 0) {
+        result = status;
+    }
+    if (pid < 0) {
+        USLOSS_Console("ERROR: could not spork testcase_main.\n");
+    }
+    USLOSS_Halt(result);
+    return 0;
+}
+
+int main(void){
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    hostPsr = USLOSS_PSR_CURRENT_MODE;
+    USLOSS_IntVec[USLOSS_CLOCK_INT] = hostClockHandler;
+    phase1_init();
+    dispatcher();
+    USLOSS_Console("ERROR: the dispatcher returned to main.\n");
+    return 1;
+}
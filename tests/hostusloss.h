@@ -0,0 +1,35 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: tests/hostusloss.h
+ * Description: Helpers that host-side tests and benchmarks get from
+ *              hostusloss.c on top of the USLOSS stand-in.
+ *
+ *              hostusloss.c provides main, which runs phase1_init and the
+ *              dispatcher, and init_main, which sporks testcase_main at
+ *              priority 3 and halts with its exit status once it is joined.
+ *              Simulated time only moves in hostWork, so runs are repeatable.
+ */
+
+#ifndef HOSTUSLOSS_H
+#define HOSTUSLOSS_H
+
+#define HOST_CLOCK_PERIOD 20000 // microseconds between clock interrupts, as in USLOSS
+
+extern int hostFailures; // checks that failed so far
+
+// records a failed check without stopping the test
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        USLOSS_Console("FAIL %s:%d: ", __FILE__, __LINE__); \
+        USLOSS_Console(__VA_ARGS__); \
+        USLOSS_Console("\n"); \
+        hostFailures++; \
+    } \
+} while (0)
+
+void hostWork(int usec);
+long long hostNanos(void);
+int hostReport(char *name);
+
+#endif
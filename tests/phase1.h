@@ -0,0 +1,29 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: tests/phase1.h
+ * Description: Stand-in for the course phase1.h, for host-side tests.
+ */
+
+#ifndef PHASE1_H
+#define PHASE1_H
+
+#include "usloss.h"
+
+#define MAXNAME 50
+#define MAXPROC 50
+
+void phase1_init(void);
+int spork(char *name, int (*startFunc)(char*), char *arg, int stackSize, int priority);
+int join(int *status);
+void quit(int status);
+int getpid(void);
+void dumpProcesses(void);
+int currentTime(void);
+void blockMe(); // phase 1b passes a block status, phase 2 passes none
+int unblockProc(int pid);
+void dispatcher(void);
+
+int testcase_main(char *arg);
+
+#endif
@@ -0,0 +1,17 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: tests/phase1helper.h
+ * Description: Stand-in for the course phase1helper.h, for host-side tests.
+ *              Both functions are provided by hostusloss.c.
+ */
+
+#ifndef PHASE1HELPER_H
+#define PHASE1HELPER_H
+
+#include "usloss.h"
+
+void russ_ContextInit(int pid, USLOSS_Context *context, void *stack, int stackSize, int (*startFunc)(char*), char *arg);
+int init_main(char *arg);
+
+#endif
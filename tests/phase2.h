@@ -0,0 +1,30 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: tests/phase2.h
+ * Description: Stand-in for the course phase2.h, for host-side tests.
+ */
+
+#ifndef PHASE2_H
+#define PHASE2_H
+
+#include "usloss.h"
+
+#define MAXMBOX 2000
+#define MAXSLOTS 2500
+#define MAX_MESSAGE 150
+#define MAXSYSCALLS 50
+
+extern void (*systemCallVec[])(USLOSS_Sysargs *args);
+
+void phase2_init(void);
+void phase2_start_service_processes(void);
+int MboxCreate(int numSlots, int slotSize);
+int MboxRelease(int mailboxID);
+int MboxSend(int mailboxID, void *msg, int msgSize);
+int MboxRecv(int mailboxID, void *msg, int maxSize);
+int MboxCondSend(int mailboxID, void *msg, int msgSize);
+int MboxCondRecv(int mailboxID, void *msg, int maxSize);
+void waitDevice(int type, int unit, int *status);
+
+#endif
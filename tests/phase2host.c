@@ -0,0 +1,23 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: tests/phase2host.c
+ * Description: Builds phase2kavin.c for the host harness on top of
+ *              phase1b-new.c. The mailboxes call blockMe() without a block
+ *              status, as the course phase 1 for phase 2 declares it, while
+ *              phase1b-new.c takes one, so the calls are routed through
+ *              hostBlockMe, which passes PHASE2_BLOCK_STATUS.
+ *              Link it in place of phase2kavin.c.
+ */
+
+#define blockMe hostBlockMe
+#include "../phase2kavin.c"
+#undef blockMe
+
+#define PHASE2_BLOCK_STATUS 11 // block status of processes blocked in a mailbox, must be over 10
+
+void blockMe(int block_status);
+
+void hostBlockMe(void){
+    blockMe(PHASE2_BLOCK_STATUS);
+}
@@ -0,0 +1,99 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: tests/test_aging.c
+ * Description: Measures the worst-case wait of a priority 5 process under a
+ *              saturating priority 1 load. Without aging it must not run
+ *              until the load is gone. With aging it must never wait longer
+ *              than it takes to age up to priority 1 and get through the
+ *              priority 1 queue once.
+ *              Build with: gcc -Itests -I. -o test_aging tests/test_aging.c tests/hostusloss.c phase1b-new.c
+ *              Usage: ./test_aging
+ */
+
+#include "phase1.h"
+#include "phase1ext.h"
+#include "usloss.h"
+#include "hostusloss.h"
+#include <stdio.h>
+
+#define QUANTUM 80000 // time slice at every priority, in microseconds
+#define HOGS 3 // priority 1 processes in the load
+#define LOAD 2000000 // CPU time each of them uses, in microseconds
+#define AGING_QUANTA 2 // aging threshold in the second round
+#define STEP 1000 // work the priority 5 process does between time readings
+
+// a promotion is checked at the next dispatch, at most one quantum late, and
+// four of them take priority 5 to 1, where at most HOGS processes are ahead
+#define WAIT_BOUND ((4 * (AGING_QUANTA + 1) + HOGS) * QUANTUM)
+
+int hogsLeft; // load processes that have not finished
+int startTime; // when the processes of a round were sporked
+int maxWait; // longest time the priority 5 process waited for the CPU
+int steps; // times the priority 5 process ran during the load
+
+int hog(char *arg){
+    hostWork(LOAD);
+    hogsLeft--;
+    return 0;
+}
+
+/**
+ * This function records the longest time it waited for the CPU, first since
+ * it was sporked and then inside each step of work, until the load is gone.
+ */
+int background(char *arg){
+    maxWait = currentTime() - startTime;
+    while (hogsLeft > 0) {
+        int before = currentTime();
+        hostWork(STEP);
+        int wait = currentTime() - before - STEP;
+        if (wait > maxWait) {
+            maxWait = wait;
+        }
+        steps++;
+    }
+    return 0;
+}
+
+/**
+ * This helper function runs the load and the priority 5 process together.
+ *
+ * @param threshold - the aging threshold, 0 for no aging
+ */
+void runRound(int threshold){
+    SporkDesc descs[HOGS + 1];
+    descs[0] = (SporkDesc){"background", background, NULL, USLOSS_MIN_STACK, 5, 0};
+    for (int i = 1; i <= HOGS; i++) {
+        descs[i] = (SporkDesc){"hog", hog, NULL, USLOSS_MIN_STACK, 1, 0};
+    }
+    CHECK(setAgingThreshold(threshold) == 0, "could not set the aging threshold");
+    hogsLeft = HOGS;
+    maxWait = 0;
+    steps = 0;
+    startTime = currentTime();
+    CHECK(sporkMany(descs, HOGS + 1) == HOGS + 1, "sporkMany failed");
+
+    int status;
+    for (int i = 0; i <= HOGS; i++) {
+        CHECK(join(&status) > 0, "join failed");
+    }
+    USLOSS_Console("aging threshold %d: worst-case wait %d us, %d steps run during the load\n",
+        threshold, maxWait, steps);
+}
+
+int testcase_main(char *arg){
+    for (int i = 1; i <= KERNEL_PRIORITIES; i++) {
+        setQuantum(i, QUANTUM);
+    }
+
+    runRound(0);
+    CHECK(steps == 0, "priority 5 ran %d steps during the load without aging", steps);
+    CHECK(maxWait >= HOGS * LOAD, "priority 5 waited %d us without aging, less than the load", maxWait);
+
+    runRound(AGING_QUANTA);
+    CHECK(steps > 0, "priority 5 never ran during the load with aging");
+    CHECK(maxWait <= WAIT_BOUND, "priority 5 waited %d us with aging, the bound is %d us", maxWait, WAIT_BOUND);
+
+    return hostReport("test_aging");
+}
@@ -0,0 +1,103 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: tests/test_join.c
+ * Description: Stress test for join. A parent fills the process table with
+ *              children, checks that one more spork fails, and joins them
+ *              all, twice, so the second round runs in reused slots. Children
+ *              quit in a different order than they were sporked, several
+ *              while the parent waits for the CPU, and join must return them
+ *              in the order they quit, each with its own exit status.
+ *              Build with: gcc -Itests -I. -o test_join tests/test_join.c tests/hostusloss.c phase1b-new.c
+ *              Usage: ./test_join
+ */
+
+#include "phase1.h"
+#include "phase1ext.h"
+#include "usloss.h"
+#include "hostusloss.h"
+#include <stdio.h>
+
+int childCount; // children sporked in the current round
+int sporkOrder[KERNEL_MAXPROC]; // argument of each child, its spork order
+int pids[KERNEL_MAXPROC]; // pid of each child, by spork order
+int quitOrder[KERNEL_MAXPROC]; // spork order of each child, by quit order
+int quitCount;
+
+/**
+ * This function works longer the earlier it was sporked, records when it
+ * quits, and exits with a status that tells which child it was.
+ */
+int child(char *arg){
+    int i = *(int*)arg;
+    hostWork((childCount - i) * 10000);
+    quitOrder[quitCount++] = i;
+    return 1000 + i;
+}
+
+/**
+ * This helper function fills the process table with children and joins all of them.
+ *
+ * @param round - the round, for messages
+ * @param oldPids - pids from the previous round that must not come back, or NULL
+ */
+void runRound(int round, int *oldPids){
+    ProcessStats stats[KERNEL_MAXPROC];
+    int live = getProcessStats(stats, KERNEL_MAXPROC);
+    childCount = KERNEL_MAXPROC - live;
+    quitCount = 0;
+
+    // the children do not preempt us, so none runs until we join
+    for (int i = 0; i < childCount; i++) {
+        sporkOrder[i] = i;
+        pids[i] = spork("child", child, (char*)&sporkOrder[i], USLOSS_MIN_STACK, 4);
+        CHECK(pids[i] > 0, "round %d: spork %d of %d failed with %d", round, i + 1, childCount, pids[i]);
+        for (int j = 0; oldPids != NULL && j < childCount; j++) {
+            CHECK(pids[i] != oldPids[j], "round %d: pid %d was handed out again", round, pids[i]);
+        }
+    }
+    int extra = spork("extra", child, (char*)&sporkOrder[0], USLOSS_MIN_STACK, 4);
+    CHECK(extra == -1, "round %d: spork %d with %d processes live returned %d, not -1",
+        round, childCount + 1, KERNEL_MAXPROC, extra);
+
+    for (int i = 0; i < childCount; i++) {
+        int status = -1;
+        int pid = join(&status);
+        // the zombie list is FIFO, so children come back in the order they quit
+        CHECK(i < quitCount, "round %d: join %d returned before the child quit", round, i + 1);
+        int expected = quitOrder[i];
+        CHECK(pid == pids[expected], "round %d: join %d returned pid %d, expected %d", round, i + 1, pid, pids[expected]);
+        CHECK(status == 1000 + expected, "round %d: join %d returned status %d, expected %d", round, i + 1, status, 1000 + expected);
+    }
+    int status;
+    CHECK(join(&status) == -2, "round %d: join with no children left did not return -2", round);
+    CHECK(quitCount == childCount, "round %d: %d of %d children quit", round, quitCount, childCount);
+    CHECK(quitOrder[0] != 0, "round %d: children quit in spork order", round);
+    // the slots are free again, and the old pids are stale
+    CHECK(getProcessStats(stats, KERNEL_MAXPROC) == live, "round %d: slots were not freed", round);
+    CHECK(getPgid(pids[0]) == -1, "round %d: stale pid %d still resolves", round, pids[0]);
+    USLOSS_Console("round %d: %d children sporked and joined, spork %d returned %d\n",
+        round, childCount, childCount + 1, extra);
+}
+
+/**
+ * This function runs both rounds. It has the same priority as the children,
+ * so they take turns with it and several quit before it gets the CPU back,
+ * which puts more than one zombie on its list.
+ */
+int parent(char *arg){
+    int firstPids[KERNEL_MAXPROC];
+    runRound(1, NULL);
+    for (int i = 0; i < childCount; i++) {
+        firstPids[i] = pids[i];
+    }
+    runRound(2, firstPids);
+    return 0;
+}
+
+int testcase_main(char *arg){
+    int status;
+    int pid = spork("parent", parent, NULL, USLOSS_MIN_STACK, 4);
+    CHECK(join(&status) == pid, "could not join the parent");
+    return hostReport("test_join");
+}
@@ -0,0 +1,128 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: tests/test_mbox_producers.c
+ * Description: Stress test for blocked producers. Many producers saturate a
+ *              one-slot mailbox, and a single consumer must get every message
+ *              of every producer exactly once and in the order it was sent,
+ *              whether it takes them with MboxRecv or MboxCondRecv. Also
+ *              reports how many dispatcher calls each round avoided.
+ *              Build with: gcc -Itests -I. -o test_mbox_producers tests/test_mbox_producers.c tests/hostusloss.c tests/phase2host.c phase1b-new.c
+ *              Usage: ./test_mbox_producers
+ */
+
+#include "phase1.h"
+#include "phase1ext.h"
+#include "phase2.h"
+#include "usloss.h"
+#include "hostusloss.h"
+#include <stdio.h>
+
+#define PRODUCERS 20
+#define MESSAGES 25 // messages each producer sends
+
+typedef struct Message {
+    int producer;
+    int seq;
+} Message;
+
+int mailbox;
+int producerIds[PRODUCERS];
+int nextSeq[PRODUCERS]; // next sequence number expected from each producer
+
+/**
+ * This function sends MESSAGES numbered messages to the mailbox.
+ */
+int producer(char *arg){
+    Message message = {*(int*)arg, 0};
+    for (; message.seq < MESSAGES; message.seq++) {
+        CHECK(MboxSend(mailbox, &message, sizeof(message)) == 0, "producer %d: send %d failed", message.producer, message.seq);
+    }
+    return 0;
+}
+
+/**
+ * This helper function checks one received message against the order each
+ * producer sent its messages in.
+ *
+ * @param size - what the receive returned
+ * @param message - the message received
+ * @param label - the receive used, for messages
+ */
+void checkMessage(int size, Message *message, char *label){
+    CHECK(size == sizeof(Message), "%s returned %d", label, size);
+    int p = message->producer;
+    if (p < 0 || p >= PRODUCERS) {
+        CHECK(0, "%s: message from unknown producer %d", label, p);
+        return;
+    }
+    CHECK(message->seq == nextSeq[p], "%s: producer %d sent message %d, got message %d", label, p, nextSeq[p], message->seq);
+    nextSeq[p] = message->seq + 1;
+}
+
+/**
+ * This helper function sporks the producers, receives all of their messages
+ * and joins them.
+ *
+ * @param label - the receive used, for messages
+ * @param priority - the producers' priority, above the consumer's keeps the mailbox full
+ * @param conditional - 1 to receive with MboxCondRecv, 0 with MboxRecv
+ */
+void runRound(char *label, int priority, int conditional){
+    int dispatches, avoided;
+    getDispatchStats(&dispatches, &avoided);
+    int startDispatches = dispatches;
+    int startAvoided = avoided;
+
+    mailbox = MboxCreate(1, sizeof(Message));
+    CHECK(mailbox >= 0, "MboxCreate failed");
+    for (int i = 0; i < PRODUCERS; i++) {
+        producerIds[i] = i;
+        nextSeq[i] = 0;
+        CHECK(spork("producer", producer, (char*)&producerIds[i], USLOSS_MIN_STACK, priority) > 0, "spork failed");
+    }
+
+    int received = 0;
+    while (received < PRODUCERS * MESSAGES) {
+        Message message = {-1, -1};
+        int size;
+        if (conditional) {
+            // the producers run first, so the mailbox stays full until all is sent
+            size = MboxCondRecv(mailbox, &message, sizeof(message));
+            if (size == -2) {
+                CHECK(0, "%s: mailbox empty after %d of %d messages", label, received, PRODUCERS * MESSAGES);
+                break;
+            }
+        } else {
+            size = MboxRecv(mailbox, &message, sizeof(message));
+        }
+        checkMessage(size, &message, label);
+        received++;
+    }
+
+    Message message;
+    CHECK(MboxCondRecv(mailbox, &message, sizeof(message)) == -2, "%s: message left over", label);
+    for (int i = 0; i < PRODUCERS; i++) {
+        CHECK(nextSeq[i] == MESSAGES, "%s: got %d of %d messages from producer %d", label, nextSeq[i], MESSAGES, i);
+    }
+    int status;
+    for (int i = 0; i < PRODUCERS; i++) {
+        CHECK(join(&status) > 0, "%s: join failed", label);
+    }
+    CHECK(MboxRelease(mailbox) == 0, "MboxRelease failed");
+
+    // every unblock of a process that does not outrank the caller skips the dispatcher
+    getDispatchStats(&dispatches, &avoided);
+    CHECK(avoided > startAvoided, "%s: no dispatcher call was avoided", label);
+    USLOSS_Console("%s: %d messages from %d producers through 1 slot, %d dispatcher passes, %d avoided\n",
+        label, received, PRODUCERS, dispatches - startDispatches, avoided - startAvoided);
+}
+
+int testcase_main(char *arg){
+    phase2_init();
+    runRound("MboxRecv", 2, 0);
+    runRound("MboxCondRecv", 2, 1);
+    // producers below the consumer find it blocked in MboxRecv instead
+    runRound("MboxRecv, producers below", 4, 0);
+    return hostReport("test_mbox_producers");
+}
@@ -0,0 +1,118 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: tests/test_recvany_inherit.c
+ * Description: Checks that a high priority process waiting in MboxRecvAny
+ *              lends its priority to the owners of the mailboxes it watches.
+ *              Two priority 5 servers each own a mailbox, and a priority 3
+ *              load would starve them. Without priority inheritance the
+ *              client must wait out the load. With it the servers run at the
+ *              client's priority, and the client gets both replies after
+ *              about as long as the servers take to produce them.
+ *              Build with: gcc -Itests -I. -o test_recvany_inherit tests/test_recvany_inherit.c tests/hostusloss.c tests/phase2host.c phase1b-new.c
+ *              Usage: ./test_recvany_inherit
+ */
+
+#include "phase1.h"
+#include "phase1ext.h"
+#include "phase2.h"
+#include "phase2ext.h"
+#include "usloss.h"
+#include "hostusloss.h"
+#include <stdio.h>
+
+#define SERVERS 2
+#define LOAD 1000000 // CPU time of the priority 3 load, in microseconds
+#define SERVE 10000 // CPU time each server uses before it replies
+#define QUANTUM 80000 // time slice at every priority, in microseconds
+
+// the servers reply one after the other, each at most a quantum late
+#define WAIT_BOUND (SERVERS * (SERVE + QUANTUM))
+
+int mailboxes[SERVERS];
+int serverIds[SERVERS];
+int startTime; // when the processes of a round were sporked
+int maxWait; // time until the client had the last reply
+
+/**
+ * This function works for a while and then replies on its mailbox.
+ */
+int server(char *arg){
+    int i = *(int*)arg;
+    hostWork(SERVE);
+    CHECK(MboxSend(mailboxes[i], &i, sizeof(int)) == 0, "server %d: send failed", i);
+    return 0;
+}
+
+/**
+ * This function takes one reply from each server with MboxRecvAny.
+ */
+int client(char *arg){
+    int got[SERVERS] = {0};
+    for (int i = 0; i < SERVERS; i++) {
+        int reply = -1;
+        int readyID = -1;
+        CHECK(MboxRecvAny(mailboxes, SERVERS, &reply, sizeof(int), &readyID) == sizeof(int), "MboxRecvAny failed");
+        if (reply < 0 || reply >= SERVERS) {
+            CHECK(0, "reply from unknown server %d", reply);
+            continue;
+        }
+        CHECK(readyID == mailboxes[reply], "reply of server %d came from mailbox %d", reply, readyID);
+        got[reply]++;
+    }
+    maxWait = currentTime() - startTime;
+    for (int i = 0; i < SERVERS; i++) {
+        CHECK(got[i] == 1, "got %d replies from server %d", got[i], i);
+    }
+    return 0;
+}
+
+/**
+ * This helper function runs the client and the servers, and is the load
+ * itself. The client goes first and blocks, and the servers only run before
+ * the load is done if the client lends them its priority. The load does not
+ * join until it is done, since a join would lend the servers its own priority.
+ *
+ * @param inherit - 1 to turn priority inheritance on, 0 to turn it off
+ */
+void runRound(int inherit){
+    setPriorityInheritance(inherit);
+    maxWait = -1;
+    startTime = currentTime();
+    for (int i = 0; i < SERVERS; i++) {
+        mailboxes[i] = MboxCreate(1, sizeof(int));
+        CHECK(mailboxes[i] >= 0, "MboxCreate failed");
+        serverIds[i] = i;
+        int pid = spork("server", server, (char*)&serverIds[i], USLOSS_MIN_STACK, 5);
+        CHECK(pid > 0, "spork failed");
+        CHECK(MboxSetOwner(mailboxes[i], pid) == 0, "MboxSetOwner failed");
+    }
+    CHECK(spork("client", client, NULL, USLOSS_MIN_STACK, 2) > 0, "spork failed");
+    hostWork(LOAD);
+
+    int status;
+    for (int i = 0; i < SERVERS + 1; i++) {
+        CHECK(join(&status) > 0, "join failed");
+    }
+    for (int i = 0; i < SERVERS; i++) {
+        CHECK(MboxRelease(mailboxes[i]) == 0, "MboxRelease failed");
+    }
+    USLOSS_Console("priority inheritance %s: the client had both replies after %d us\n",
+        inherit ? "on" : "off", maxWait);
+}
+
+int testcase_main(char *arg){
+    phase2_init();
+    for (int i = 1; i <= KERNEL_PRIORITIES; i++) {
+        setQuantum(i, QUANTUM);
+    }
+
+    runRound(0);
+    CHECK(maxWait >= LOAD, "the client waited %d us without inheritance, less than the load", maxWait);
+
+    runRound(1);
+    CHECK(maxWait >= 0 && maxWait <= WAIT_BOUND, "the client waited %d us with inheritance, the bound is %d us",
+        maxWait, WAIT_BOUND);
+
+    return hostReport("test_recvany_inherit");
+}
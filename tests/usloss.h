@@ -0,0 +1,59 @@
+/**
+ * Authors: Cumhur Aygar, Kavin Krisnaamani Janarthanan
+ * Course: CSC 452 Fall 2024
+ * File: tests/usloss.h
+ * Description: Stand-in for the course usloss.h, with only the parts the
+ *              kernel uses. Implemented on the host by hostusloss.c, so the
+ *              kernel can be tested and measured without the simulator.
+ */
+
+#ifndef USLOSS_H
+#define USLOSS_H
+
+#include <ucontext.h>
+
+#define USLOSS_MIN_STACK (80 * 1024)
+
+// processor status register bits
+#define USLOSS_PSR_CURRENT_MODE 0x1 // set in kernel mode
+#define USLOSS_PSR_CURRENT_INT 0x2 // set while interrupts are enabled
+
+// devices, the interrupt of each device has the same number
+#define USLOSS_CLOCK_DEV 0
+#define USLOSS_TERM_DEV 2
+#define USLOSS_DISK_DEV 3
+#define USLOSS_CLOCK_INT 0
+#define USLOSS_TERM_INT 2
+#define USLOSS_DISK_INT 3
+#define USLOSS_SYSCALL_INT 4
+#define USLOSS_NUM_INTS 5
+#define USLOSS_TERM_UNITS 4
+#define USLOSS_DISK_UNITS 2
+
+#define USLOSS_DEV_OK 0
+#define USLOSS_DEV_INVALID 1
+
+typedef struct USLOSS_Context {
+    ucontext_t context;
+} USLOSS_Context;
+
+typedef struct USLOSS_Sysargs {
+    int number;
+    void *arg1;
+    void *arg2;
+    void *arg3;
+    void *arg4;
+    void *arg5;
+} USLOSS_Sysargs;
+
+extern void (*USLOSS_IntVec[USLOSS_NUM_INTS])(int dev, void *arg);
+
+unsigned int USLOSS_PsrGet(void);
+int USLOSS_PsrSet(unsigned int psr);
+void USLOSS_Console(char *format, ...);
+void USLOSS_Halt(int status);
+void USLOSS_ContextInit(USLOSS_Context *context, void *stack, int stackSize, void *pageTable, void (*func)(void));
+void USLOSS_ContextSwitch(USLOSS_Context *old, USLOSS_Context *new);
+int USLOSS_DeviceInput(int dev, int unit, int *status);
+
+#endif